@@ -0,0 +1,387 @@
+/*
+* Copyright (c) 2009-2011, A. Buades <toni.buades@uib.es>
+* All rights reserved.
+*  
+*
+* Patent warning:
+*
+* This file implements algorithms possibly linked to the patents
+* 
+* # J. Hamilton Jr and J. Adams Jr, “Adaptive color plan interpolation
+* in single sensor color electronic camera,” 1997, US Patent 5,629,734.
+*
+* # D. Cok, “Signal processing method and apparatus for producing
+* interpolated chrominance values in a sampled color image signal”,
+* 1987, US Patent 4,642,678.
+* 
+* # A. Buades, T. Coll and J.M. Morel, Image data processing method by
+* reducing image noise, and camera integrating means for implementing
+* said method, EP Patent 1,749,278 (Feb. 7, 2007). 
+* 
+* This file is made available for the exclusive aim of serving as
+* scientific tool to verify the soundness and completeness of the
+* algorithm description. Compilation, execution and redistribution
+* of this file may violate patents rights in certain countries.
+* The situation being different for every country and changing
+* over time, it is your responsibility to determine which patent
+* rights restrictions apply to you before you compile, use,
+* modify, or redistribute this file. A patent lawyer is qualified
+* to make this determination.
+* If and only if they don't conflict with any patent terms, you
+* can benefit from the following license terms attached to this
+* file.
+* 
+* License:
+*
+* This program is provided for scientific and educational only:
+* you can use and/or modify it for these purposes, but you are
+* not allowed to redistribute this work or derivative works in
+* source or executable form. A license must be obtained from the
+* patent right holders for any other use.
+*
+*
+*/
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/time.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+
+#include "libdemosaicking.h"
+
+
+/**
+ * @file   benchmarkAdams.cpp
+ * @brief  Benchmark of the Adams-Hamilton demosaicking
+ *
+ * A synthetic 8bit Bayer mosaic of the given size (default 4000x3000) is demosaicked by 
+ * demosaicking_adams and by the former implementation, kept below as reference: the pixels 
+ * are visited column by column over the whole frame, the CFA position being tested at each 
+ * pixel. The mean run time of both (over repeat runs) and the speedup are printed for each 
+ * number of threads of the list (with OpenMP), with the number of output values which 
+ * differ from the reference.
+ *
+ * The differences are counted for the 8bit mosaic and for a 16bit mosaic scaled to [0,255] 
+ * as by the 16bit TIFF and raw inputs, whose values are fractional. Compiled without 
+ * -ffast-math, the outputs are bitwise identical. With the -ffast-math of the Makefile the 
+ * compiler reassociates the sums differently in the vectorized loops and in the reference, 
+ * and a few values differ in the last bit.
+ */
+
+
+
+/**
+ * @brief Current time in seconds.
+ */
+static double wall_time()
+{
+    struct timeval t;
+    gettimeofday(&t, NULL);
+    return t.tv_sec + 1e-6 * t.tv_usec;
+}
+
+
+
+/**
+ * @brief Former implementation of demosaicking_bilinear_red_blue (reference).
+ */
+static void reference_bilinear_red_blue(int redx,int redy,float *ored,float *ogreen,float *oblue,int width,int height)
+{
+	
+	int bluex = 1 - redx;
+	int bluey = 1 - redy;
+	
+	for(int i=0; i < width*height;i++){
+		
+		ored[i] -= ogreen[i];
+		oblue[i] -= ogreen[i];
+		
+	}
+	
+	for(int x=0; x < width;x++)
+		for(int y=0; y < height;y++)
+			if ((x&1) != bluex || (y&1) != bluey){
+				
+				int gn, gs, ge, gw;
+				
+				if (y > 0)  gn = y-1;	else    gn = 1;
+				if (y < height-1)	gs = y+1;  else  gs = height - 2 ;
+				if (x < width-1)  ge = x+1;  else  ge = width-2;
+				if (x > 0) gw = x-1;	else  gw = 1;
+				
+				int green = ((x&1) == redx) != ((y&1) == redy);
+				
+				if (green && y % 2 == bluey) 
+					oblue[y*width+x] = ( oblue[y*width+ge] + oblue[y*width+gw])/2.0;
+				else if (green && x % 2 == bluex) 
+					oblue[y*width+x] = ( oblue[gn*width+x] + oblue[gs*width+x])/2.0;
+				else {
+					oblue[y*width+x] =  (oblue[gn*width+ge] + oblue[gn*width + gw]  +  oblue[gs*width + ge] +  oblue[gs*width +gw])/4.0;		 
+				}
+				
+			}
+	
+	for(int x=0;x<width;x++)
+		for(int y=0;y<height;y++)
+			if ((x&1) != redx || (y&1) != redy){
+				
+				int gn, gs, ge, gw;
+				
+				if (y > 0)  gn = y-1;	else    gn = 1;
+				if (y < height-1)	gs = y+1;  else  gs = height - 2 ;
+				if (x < width-1)  ge = x+1;  else  ge = width-2;
+				if (x > 0) gw = x-1;	else  gw = 1;
+				
+				int green = ((x&1) == redx) != ((y&1) == redy);
+				
+				if (green && y % 2 == redy) 
+					ored[y*width+x] = ( ored[y*width+ge] + ored[y*width+gw])/2.0;
+				else if (green && x % 2 == redx) 
+					ored[y*width+x] = ( ored[gn*width+x] + ored[gs*width+x])/2.0;
+				else {
+					ored[y*width+x] =  (ored[gn*width+ge] + ored[gn*width + gw]  +  ored[gs*width + ge] +  ored[gs*width +gw])/4.0;	 
+				}
+				
+			}
+	
+	for(int i=0;i<width*height;i++){
+		
+		ored[i] += ogreen[i];
+		oblue[i] += ogreen[i];
+	}
+	
+}
+
+
+
+/**
+ * @brief Former implementation of demosaicking_adams (reference).
+ */
+static void reference_adams(float threshold, int redx,int redy,float *ired,float *igreen,float *iblue,float *ored,float *ogreen,float *oblue,int width,int height)
+{
+	
+	wxCopy(ired,ored,width*height);
+	wxCopy(igreen,ogreen,width*height);
+	wxCopy(iblue,oblue,width*height);
+	
+	for(int x=0;x<width;x++)
+		for(int y=0;y<height;y++)
+			if ( (((x&1) == redx) == ((y&1) == redy)) && (x < 3 || y < 3 || x>= width - 3 || y>= height - 3 )) { 
+				
+				int gn, gs, ge, gw;
+				
+				if (y > 0)  gn = y-1;	else    gn = 1;
+				if (y < height-1)	gs = y+1;  else  gs = height - 2 ;
+				if (x < width-1)  ge = x+1;  else  ge = width-2;
+				if (x > 0) gw = x-1;	else  gw = 1;
+				
+				ogreen[y*width + x] = (ogreen[gn*width + x] +  ogreen[gs*width + x] + ogreen[y*width + gw] +  ogreen[y*width + ge])/ 4.0;
+				
+			}
+	
+	for(int x=3;x<width-3;x++)
+		for(int y=3;y<height-3;y++)
+			if (((x&1) == redx) == ((y&1) == redy)) {  
+				
+				int l = y*width+x;
+				int lp1 = (y+1)*width +x;
+				int lp2 = (y+2)*width +x;
+				int lm1 = (y-1)*width +x;
+				int lm2 = (y-2)*width +x;
+				
+				float adv = fabsf(ogreen[lp1] - ogreen[lm1]);
+				float adh = fabsf(ogreen[l-1] - ogreen[l+1]);
+				float dh0, dv0;
+				
+				if ((x&1) != redx){  
+					
+					dh0 = 2.0 * oblue[l] - oblue[l+2] - oblue[l-2];	
+					dv0 = 2.0 * oblue[l] - oblue[lp2] - oblue[lm2];
+					
+				} else { 			
+					
+					dh0 = 2.0 * ored[l] - ored[l+2] - ored[l-2];	
+					dv0 = 2.0 * ored[l] - ored[lp2] - ored[lm2];
+					
+				}	
+				
+				adh = adh + fabsf(dh0);
+				adv = adv + fabsf(dv0);
+				
+				if (fabsf(adv - adh) < threshold)
+					ogreen[l] = (ogreen[lm1] +  ogreen[lp1] +  ogreen[l-1] + ogreen[l+1]) /4.0 + (dh0 + dv0) / 8.0;
+				else if (adh < adv )
+					ogreen[l] = (ogreen[l-1] + ogreen[l+1])/2.0 + (dh0)/4.0;
+				else if ( adv < adh ) 			
+					ogreen[l] = (ogreen[lp1] + ogreen[lm1])/2.0 + (dv0)/4.0;
+				
+			}
+	
+	reference_bilinear_red_blue(redx,redy,ored,ogreen,oblue,width,height);
+	
+}
+
+
+
+/**
+ * @brief Synthetic Bayer mosaic (RGGB): smooth colors, edges and
+ * texture, the missing values being 0. The samples have the given
+ * number of bits (8 or 16) and are scaled to [0,255].
+ */
+static void synthetic_mosaic(float *red, float *green, float *blue,
+                             int width, int height, int bits)
+{
+    float scale = (float) ((1 << bits) - 1) / 255.0f;
+
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+        {
+            int l = y * width + x;
+            float edge = ((x / 37 + y / 23) % 2) ? 60.0f : 0.0f;
+            float r = 90 + 60 * sin(0.011f * x) + edge + (rand() % 16);
+            float g = 110 + 50 * cos(0.007f * y) + edge + (rand() % 16);
+            float b = 80 + 40 * sin(0.005f * (x + y)) + edge + (rand() % 16);
+
+            red[l] = green[l] = blue[l] = 0;
+            if (0 == x % 2 && 0 == y % 2)
+                red[l] = floor(r * scale) / scale;
+            else if (1 == x % 2 && 1 == y % 2)
+                blue[l] = floor(b * scale) / scale;
+            else
+                green[l] = floor(g * scale) / scale;
+        }
+}
+
+
+
+int main(int argc, char **argv)
+{
+	
+    int width = 4000, height = 3000, repeat = 5;
+    const char *thread_list = "1";
+    float *in, *in16, *out, *ref;
+    size_t n;
+
+    /* options */
+    while (2 <= argc && '-' == argv[1][0])
+    {
+        if (3 <= argc && 0 == strcmp("-r", argv[1]))
+            repeat = atoi(argv[2]);
+        else if (3 <= argc && 0 == strcmp("-t", argv[1]))
+            thread_list = argv[2];
+        else
+            break;
+        argv += 2;
+        argc -= 2;
+    }
+
+    if (3 == argc)
+    {
+        width = atoi(argv[1]);
+        height = atoi(argv[2]);
+    }
+
+    /* sanity check */
+    if ((1 != argc && 3 != argc) || 7 > width || 7 > height || 1 > repeat)
+    {
+        fprintf(stderr, "usage : %s [-r repeat] [-t threads,...] [width height]\n",
+                argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    n = (size_t) width * height;
+    in = (float *) malloc(sizeof(float) * n * 3);
+    in16 = (float *) malloc(sizeof(float) * n * 3);
+    out = (float *) malloc(sizeof(float) * n * 3);
+    ref = (float *) malloc(sizeof(float) * n * 3);
+    if (NULL == in || NULL == in16 || NULL == out || NULL == ref)
+    {
+        fprintf(stderr, "allocation error. not enough memory?\n");
+        return EXIT_FAILURE;
+    }
+
+    srand(1);
+    synthetic_mosaic(in, in + n, in + 2 * n, width, height, 8);
+    srand(1);
+    synthetic_mosaic(in16, in16 + n, in16 + 2 * n, width, height, 16);
+
+    printf("frame %dx%d, mean of %d runs (ms) on the 8bit mosaic, different "
+           "values for the 8bit and 16bit mosaics\n", width, height, repeat);
+    printf("%7s %10s %10s %8s %10s %10s %10s\n", "threads", "reference",
+           "adams", "speedup", "diff 8bit", "diff 16bit", "max diff");
+
+    for (const char *p = thread_list; *p;)
+    {
+        int threads = atoi(p);
+        double t_ref = 0, t_new = 0;
+        size_t different = 0, different16 = 0;
+        float max_diff = 0;
+
+#ifdef _OPENMP
+        omp_set_num_threads(threads);
+#else
+        if (1 != threads)
+            fprintf(stderr, "compiled without OpenMP: %d threads measured as 1\n",
+                    threads);
+#endif
+
+        for (int r = 0; r < repeat; r++)
+        {
+            double t0 = wall_time();
+            reference_adams(2.0, 0, 0, in, in + n, in + 2 * n,
+                            ref, ref + n, ref + 2 * n, width, height);
+            double t1 = wall_time();
+            demosaicking_adams(2.0, 0, 0, in, in + n, in + 2 * n,
+                               out, out + n, out + 2 * n, width, height);
+            double t2 = wall_time();
+
+            t_ref += t1 - t0;
+            t_new += t2 - t1;
+        }
+
+        /* bitwise comparison of the outputs */
+        different = 0;
+        for (size_t i = 0; i < 3 * n; i++)
+            if (0 != memcmp(&out[i], &ref[i], sizeof(float)))
+            {
+                different++;
+                max_diff = MAX(max_diff, fabsf(out[i] - ref[i]));
+            }
+
+        reference_adams(2.0, 0, 0, in16, in16 + n, in16 + 2 * n,
+                        ref, ref + n, ref + 2 * n, width, height);
+        demosaicking_adams(2.0, 0, 0, in16, in16 + n, in16 + 2 * n,
+                           out, out + n, out + 2 * n, width, height);
+        for (size_t i = 0; i < 3 * n; i++)
+            if (0 != memcmp(&out[i], &ref[i], sizeof(float)))
+            {
+                different16++;
+                max_diff = MAX(max_diff, fabsf(out[i] - ref[i]));
+            }
+
+        printf("%7d %10.2f %10.2f %8.2f %10lu %10lu %10.2g\n", threads,
+               1000.0 * t_ref / repeat, 1000.0 * t_new / repeat,
+               t_new > 0 ? t_ref / t_new : 0.0, (unsigned long) different,
+               (unsigned long) different16, max_diff);
+
+        while (*p && ',' != *p)
+            p++;
+        if (',' == *p)
+            p++;
+    }
+
+    free(in);
+    free(in16);
+    free(out);
+    free(ref);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,482 @@
+/*
+* Copyright (c) 2009-2011, A. Buades <toni.buades@uib.es>
+* All rights reserved.
+*  
+*
+* Patent warning:
+*
+* This file implements algorithms possibly linked to the patents
+* 
+* # J. Hamilton Jr and J. Adams Jr, “Adaptive color plan interpolation
+* in single sensor color electronic camera,” 1997, US Patent 5,629,734.
+*
+* # D. Cok, “Signal processing method and apparatus for producing
+* interpolated chrominance values in a sampled color image signal”,
+* 1987, US Patent 4,642,678.
+* 
+* # A. Buades, T. Coll and J.M. Morel, Image data processing method by
+* reducing image noise, and camera integrating means for implementing
+* said method, EP Patent 1,749,278 (Feb. 7, 2007). 
+* 
+* This file is made available for the exclusive aim of serving as
+* scientific tool to verify the soundness and completeness of the
+* algorithm description. Compilation, execution and redistribution
+* of this file may violate patents rights in certain countries.
+* The situation being different for every country and changing
+* over time, it is your responsibility to determine which patent
+* rights restrictions apply to you before you compile, use,
+* modify, or redistribute this file. A patent lawyer is qualified
+* to make this determination.
+* If and only if they don't conflict with any patent terms, you
+* can benefit from the following license terms attached to this
+* file.
+* 
+* License:
+*
+* This program is provided for scientific and educational only:
+* you can use and/or modify it for these purposes, but you are
+* not allowed to redistribute this work or derivative works in
+* source or executable form. A license must be obtained from the
+* patent right holders for any other use.
+*
+*
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+
+#include "libdemosaicking.h"
+#include "io_tiff.h"
+#include "io_raw.h"
+
+
+/**
+ * @file   demosaickingBatch.cpp
+ * @brief  Demosaicking of a list of frames
+ *
+ * The input is a manifest: a text file with the name of one frame per line (same inputs as 
+ * demosaickingIpol: Bayer mosaics as raw dumps or single channel TIFF, or RGBA TIFF). Each frame 
+ * is demosaicked by the tiled chain and written as an RGBA TIFF in the output directory, with the 
+ * name of the input frame and the extension .tiff. The manifest is read before any frame is 
+ * processed and rejected when two frames would give the same output file.
+ *
+ * With OpenMP (`make OMP=1`) the frames are processed by a pool of worker threads. Each worker 
+ * takes the next frame of the list, decodes it, demosaicks it and encodes it, so the input and 
+ * output of a frame overlap the processing of the other frames. Each worker keeps its buffers from 
+ * one frame to the next: the workspace of the chain (parameters, tile planes and table of Exp(-x)) 
+ * and the output planes.
+ *
+ * For each frame the input and the output are printed. At the end, the number of frames per second 
+ * and the time spent in each stage (summed over the workers) are printed.
+ */
+
+
+
+/* default size of the tiles */
+#define BATCH_TILE 256
+
+
+
+/**
+ * @brief Current time in seconds.
+ */
+static double wall_time()
+{
+    struct timeval t;
+    gettimeofday(&t, NULL);
+    return t.tv_sec + 1e-6 * t.tv_usec;
+}
+
+
+
+/**
+ * @brief Frame of the manifest: input and output file names.
+ */
+struct batch_frame
+{
+    char *name;
+    char *out;
+};
+
+
+
+/**
+ * @brief Read the names of the frames of the manifest, skipping the
+ * empty lines.
+ *
+ * @return array of nframes frames (output names not set), NULL on error
+ */
+static batch_frame *read_manifest(FILE *manifest, int *nframes)
+{
+    char name[4096];
+    int size = 64;
+    batch_frame *frames = (batch_frame *) malloc(size * sizeof(batch_frame));
+    batch_frame *larger;
+
+    *nframes = 0;
+    if (NULL == frames)
+        return NULL;
+    while (NULL != fgets(name, (int) sizeof(name), manifest))
+    {
+        size_t n = strlen(name);
+        while (0 < n && ('\n' == name[n - 1] || '\r' == name[n - 1]
+                         || ' ' == name[n - 1]))
+            name[--n] = '\0';
+        if (0 == n)
+            continue;
+
+        if (*nframes == size)
+        {
+            size *= 2;
+            larger = (batch_frame *) realloc(frames, size * sizeof(batch_frame));
+            if (NULL == larger)
+            {
+                free(frames);
+                return NULL;
+            }
+            frames = larger;
+        }
+        frames[*nframes].name = strdup(name);
+        frames[*nframes].out = NULL;
+        (*nframes)++;
+    }
+    return frames;
+}
+
+
+
+/**
+ * @brief Name of the output frame: the file name of the input frame in
+ * the output directory, with the extension .tiff.
+ */
+static char *output_name(const char *dir, const char *name)
+{
+    const char *base = strrchr(name, '/');
+    const char *dot;
+    char *out;
+    int len;
+
+    base = (NULL == base) ? name : base + 1;
+    dot = strrchr(base, '.');
+    len = (NULL == dot) ? (int) strlen(base) : (int) (dot - base);
+    out = (char *) malloc(strlen(dir) + len + 7);
+    sprintf(out, "%s/%.*s.tiff", dir, len, base);
+    return out;
+}
+
+
+
+/**
+ * @brief Order of two frames by output name, for qsort().
+ */
+static int compare_output_names(const void *a, const void *b)
+{
+    return strcmp((*(batch_frame * const *) a)->out,
+                  (*(batch_frame * const *) b)->out);
+}
+
+
+
+/**
+ * @brief Set the output name of each frame.
+ *
+ * Frames with the same file name in different directories, or differing
+ * only by the extension, would be written to the same output file, by two
+ * workers at once. All the colliding frames are reported.
+ *
+ * @return number of collisions
+ */
+static int set_output_names(batch_frame *frames, int nframes,
+                            const char *dir)
+{
+    batch_frame **sorted;
+    int i, collisions = 0;
+
+    for (i = 0; i < nframes; i++)
+        frames[i].out = output_name(dir, frames[i].name);
+
+    /* equal output names are consecutive once sorted */
+    sorted = (batch_frame **) malloc((0 < nframes ? nframes : 1)
+                                     * sizeof(batch_frame *));
+    for (i = 0; i < nframes; i++)
+        sorted[i] = frames + i;
+    qsort(sorted, nframes, sizeof(batch_frame *), compare_output_names);
+    for (i = 1; i < nframes; i++)
+        if (0 == strcmp(sorted[i - 1]->out, sorted[i]->out))
+        {
+            fprintf(stderr, "%s and %s would both be written to %s\n",
+                    sorted[i - 1]->name, sorted[i]->name, sorted[i]->out);
+            collisions++;
+        }
+    free(sorted);
+
+    return collisions;
+}
+
+
+
+int main(int argc, char **argv)
+{
+	
+    unsigned char redx, redy;
+    char *pattern_str;
+    size_t rx = 0, ry = 0;
+    int raw = 0, bits = 8;
+    int tile = BATCH_TILE, threads = 0;
+    ssd_parameters par;
+    FILE *manifest;
+    batch_frame *list;
+    int nlist;
+    int frames = 0, failures = 0;
+    double t_decode = 0, t_demosaic = 0, t_encode = 0;
+    double start, elapsed;
+
+    /* options */
+    ssd_preset("reference", &par);
+    while (2 <= argc && '-' == argv[1][0])
+    {
+        if (5 <= argc && 0 == strcmp("-r", argv[1]))
+        {
+            raw = 1;
+            rx = (size_t) atoi(argv[2]);
+            ry = (size_t) atoi(argv[3]);
+            bits = atoi(argv[4]);
+            argv += 4;
+            argc -= 4;
+        }
+        else if (3 <= argc && 0 == strcmp("-t", argv[1]))
+        {
+            threads = atoi(argv[2]);
+            argv += 2;
+            argc -= 2;
+        }
+        else if (3 <= argc && 0 == strcmp("-p", argv[1]))
+        {
+            if (!ssd_preset(argv[2], &par))
+            {
+                fprintf(stderr, "preset must be fast, balanced or reference\n");
+                return EXIT_FAILURE;
+            }
+            argv += 2;
+            argc -= 2;
+        }
+        else if (3 <= argc && 0 == strcmp("-s", argv[1]))
+        {
+            tile = atoi(argv[2]);
+            argv += 2;
+            argc -= 2;
+        }
+        else
+            break;
+    }
+
+    /* sanity check */
+    if (4 != argc || 0 >= tile || 0 > threads)
+    {
+        fprintf(stderr, "usage : %s [-r width height bits] [-t threads] [-p preset] "
+                "[-s tile] manifest.txt output_dir pattern\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    /* pattern */
+    pattern_str = argv[3];
+    if (0 == strcmp("RGGB", pattern_str))
+    {
+		redx = 0;
+		redy = 0;
+    }
+    else if (0 == strcmp("GRBG", pattern_str))
+    {
+		redx = 1;
+		redy = 0;
+    }
+    else if (0 == strcmp("GBRG", pattern_str))
+    {
+		redx = 0;
+		redy = 1;
+    }
+    else if (0 == strcmp("BGGR", pattern_str))
+    {
+		redx = 1;
+		redy = 1;
+    }
+    else
+    {
+        fprintf(stderr, "pattern must be RGGB, GRBG, GBRG or BGGR\n");
+        return EXIT_FAILURE;
+    }
+
+    if (NULL == (manifest = fopen(argv[1], "r")))
+    {
+        fprintf(stderr, "error while reading from %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+    list = read_manifest(manifest, &nlist);
+    fclose(manifest);
+    if (NULL == list)
+    {
+        fprintf(stderr, "allocation error. not enough memory?\n");
+        return EXIT_FAILURE;
+    }
+
+    /* output names, checked before any frame is written */
+    if (0 < set_output_names(list, nlist, argv[2]))
+    {
+        fprintf(stderr, "frames of the manifest with the same output name\n");
+        return EXIT_FAILURE;
+    }
+
+    /* the frames are processed in parallel, each one by a single worker */
+#ifdef _OPENMP
+    if (0 < threads)
+        omp_set_num_threads(threads);
+#else
+    if (1 < threads)
+        fprintf(stderr, "compiled without OpenMP: one worker\n");
+#endif
+
+    start = wall_time();
+
+#pragma omp parallel reduction(+:frames,failures,t_decode,t_demosaic,t_encode)
+    {
+        /* buffers of the worker, kept from one frame to the next */
+        ssd_workspace ws;
+        float *data_out = NULL;
+        size_t out_size = 0;
+
+        ssd_workspace_alloc(&ws, tile, &par);
+
+        /* each worker takes the next frame of the manifest */
+#pragma omp for schedule(dynamic, 1)
+        for (int i = 0; i < nlist; i++)
+        {
+            const char *name = list[i].name;
+            const char *out = list[i].out;
+            size_t nx = rx, ny = ry;
+            float *data_cfa = NULL, *data_in = NULL;
+            float *out_ptr, *end_ptr;
+            double t0, t1, t2, t3;
+            int status;
+
+            /* input: Bayer mosaic in one plane, else RGBA */
+            t0 = wall_time();
+            if (raw)
+                data_cfa = read_raw_gray_f32(name, nx, ny, bits);
+            else if (NULL == (data_cfa = read_tiff_gray_f32(name, &nx, &ny)))
+                data_in = read_tiff_rgba_f32(name, &nx, &ny);
+
+            if (NULL == data_cfa && NULL == data_in)
+            {
+#pragma omp critical (output)
+                fprintf(stderr, "error while reading from %s\n", name);
+                failures++;
+                continue;
+            }
+
+            /* output planes, reallocated only for a larger frame */
+            if (out_size < 4 * nx * ny)
+            {
+                free(data_out);
+                out_size = 4 * nx * ny;
+                data_out = (float *) malloc(sizeof(float) * out_size);
+            }
+            if (NULL == data_out)
+            {
+#pragma omp critical (output)
+                fprintf(stderr, "allocation error. not enough memory?\n");
+                out_size = 0;
+                free(data_cfa);
+                free(data_in);
+                failures++;
+                continue;
+            }
+            t1 = wall_time();
+
+            /* process */
+            if (NULL != data_cfa)
+            {
+                ssd_demosaicking_chain_cfa(redx, redy, data_cfa,
+                      data_out, data_out + nx * ny, data_out + 2 * nx * ny,
+                      (int) nx, (int) ny, tile, &ws);
+
+                /* opaque alpha channel */
+                out_ptr = data_out + 3 * nx * ny;
+                end_ptr = out_ptr + nx * ny;
+                while (out_ptr < end_ptr)
+                    *out_ptr++ = 255;
+            }
+            else
+            {
+                ssd_demosaicking_chain_tiled(redx, redy,
+                      data_in, data_in + nx * ny, data_in + 2 * nx * ny,
+                      data_out, data_out + nx * ny, data_out + 2 * nx * ny,
+                      (int) nx, (int) ny, tile, &ws);
+
+                /* copy alpha channel */
+                memcpy(data_out + 3 * nx * ny, data_in + 3 * nx * ny,
+                       nx * ny * sizeof(float));
+            }
+            free(data_cfa);
+            free(data_in);
+
+            /* limit to 0-255 */
+            out_ptr = data_out;
+            end_ptr = out_ptr + 3 * nx * ny;
+            while (out_ptr < end_ptr)
+            {
+                if (0 > *out_ptr)
+                    *out_ptr = 0;
+                if (255 < *out_ptr)
+                    *out_ptr = 255;
+                out_ptr++;
+            }
+            t2 = wall_time();
+
+            /* TIFF RGBA float->8bit output */
+            status = write_tiff_rgba_f32(out, data_out, nx, ny);
+            t3 = wall_time();
+
+#pragma omp critical (output)
+            {
+                if (0 != status)
+                    fprintf(stderr, "error while writing to %s\n", out);
+                else
+                    printf("%s %s\n", name, out);
+            }
+            if (0 != status)
+                failures++;
+            else
+                frames++;
+
+            t_decode += t1 - t0;
+            t_demosaic += t2 - t1;
+            t_encode += t3 - t2;
+        }
+
+        ssd_workspace_free(&ws);
+        free(data_out);
+    }
+    elapsed = wall_time() - start;
+
+    for (int i = 0; i < nlist; i++)
+    {
+        free(list[i].name);
+        free(list[i].out);
+    }
+    free(list);
+
+    printf("FRAMES: %d (%d failed) in %.3f s, %.2f frames/s\n", frames,
+           failures, elapsed, 0 < elapsed ? frames / elapsed : 0.0);
+    printf("STAGES (s, summed over the workers): decode %.3f, "
+           "demosaic %.3f, encode %.3f\n", t_decode, t_demosaic, t_encode);
+
+    return 0 < failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -58,6 +58,7 @@
 
 #include "libdemosaicking.h"
 #include "io_tiff.h"
+#include "io_raw.h"
 #include "tiffio.h"
 
 
@@ -76,13 +77,21 @@
 
 
 
+/* default size of the tiles when the input is a Bayer mosaic */
+#define CFA_TILE 256
+
+
+
 int main(int argc, char **argv)
 {
 	
     unsigned char redx, redy;
-    char *pattern_str = argv[3];
+    char *pattern_str;
     size_t nx = 0, ny = 0;
-    float *data_in, *data_out;
+    int tile = 0;
+    int raw = 0, bits = 8;
+    ssd_parameters par;
+    float *data_in, *data_out, *data_cfa = NULL;
     float *out_ptr, *end_ptr;
 	
     /* version info */
@@ -91,14 +100,53 @@ int main(int argc, char **argv)
         fprintf(stdout, "%s version " __DATE__ "\n", argv[0]);
         return EXIT_SUCCESS;
     }
+	
+    /* parameters of the chain */
+    ssd_preset("reference", &par);
+	
+    /* options */
+    while (2 <= argc && '-' == argv[1][0])
+    {
+        /* raw dump: size and number of bits of the samples */
+        if (5 <= argc && 0 == strcmp("-r", argv[1]))
+        {
+            raw = 1;
+            nx = (size_t) atoi(argv[2]);
+            ny = (size_t) atoi(argv[3]);
+            bits = atoi(argv[4]);
+            argv += 4;
+            argc -= 4;
+        }
+        /* quality-speed preset */
+        else if (3 <= argc && 0 == strcmp("-p", argv[1]))
+        {
+            if (!ssd_preset(argv[2], &par))
+            {
+                fprintf(stderr, "preset must be fast, balanced or reference\n");
+                return EXIT_FAILURE;
+            }
+            argv += 2;
+            argc -= 2;
+        }
+        else
+            break;
+    }
+	
     /* sanity check */
-    if (4 != argc)
+    if (4 != argc && 5 != argc)
     {
-        fprintf(stderr, "usage : %s input.tiff output.tiff pattern\n",
+        fprintf(stderr, "usage : %s [-r width height bits] [-p preset] input output.tiff pattern [tile]\n",
 				argv[0]);
         return EXIT_FAILURE;
     }
 	
+    /* tiles */
+    if (5 == argc && 0 >= (tile = atoi(argv[4])))
+    {
+        fprintf(stderr, "tile must be a positive size\n");
+        return EXIT_FAILURE;
+    }
+	
     /* pattern */
     pattern_str = argv[3];
     if (0 == strcmp("RGGB", pattern_str))
@@ -127,26 +175,67 @@ int main(int argc, char **argv)
         return EXIT_FAILURE;
     }
 	
-    /* TIFF RGBA 8bit->float input */
-    if (NULL == (data_in = read_tiff_rgba_f32(argv[1], &nx, &ny)))
+    /*
+     * Bayer mosaic input (raw dump or 8/16bit gray TIFF): one plane,
+     * else TIFF RGBA 8bit->float input
+     */
+    if (raw)
+        data_cfa = read_raw_gray_f32(argv[1], nx, ny, bits);
+    else
+        data_cfa = read_tiff_gray_f32(argv[1], &nx, &ny);
+	
+    if (NULL != data_cfa)
     {
-        fprintf(stderr, "error while reading from %s\n", argv[1]);
-        return EXIT_FAILURE;
+        if (NULL == (data_out = (float *) malloc(sizeof(float) * nx * ny * 4)))
+        {
+            fprintf(stderr, "allocation error. not enough memory?\n");
+            free(data_cfa);
+            return EXIT_FAILURE;
+        }
+		
+        /* process */
+        ssd_demosaicking_chain_cfa(redx, redy, data_cfa,
+                      data_out, data_out + nx * ny, data_out + 2 * nx * ny,
+                      (int) nx, (int) ny, 0 < tile ? tile : CFA_TILE, NULL, &par);
+        free(data_cfa);
+		
+        /* opaque alpha channel */
+        out_ptr = data_out + 3 * nx * ny;
+        end_ptr = out_ptr + nx * ny;
+        while (out_ptr < end_ptr)
+            *out_ptr++ = 255;
     }
-    if (NULL == (data_out = (float *) malloc(sizeof(float) * nx * ny * 4)))
+    else
     {
-        fprintf(stderr, "allocation error. not enough memory?\n");
-		free(data_in);
-        return EXIT_FAILURE;
-    }
-	
-	
-	
-    /* process */	
-	ssd_demosaicking_chain(redx, redy,
+        if (raw || NULL == (data_in = read_tiff_rgba_f32(argv[1], &nx, &ny)))
+        {
+            fprintf(stderr, "error while reading from %s\n", argv[1]);
+            return EXIT_FAILURE;
+        }
+        if (NULL == (data_out = (float *) malloc(sizeof(float) * nx * ny * 4)))
+        {
+            fprintf(stderr, "allocation error. not enough memory?\n");
+            free(data_in);
+            return EXIT_FAILURE;
+        }
+		
+        /* process */	
+        if (0 < tile)
+            ssd_demosaicking_chain_tiled(redx, redy,
                       data_in, data_in + nx * ny, data_in + 2 * nx * ny,
                       data_out, data_out + nx * ny, data_out + 2 * nx * ny,
-                      (int) nx, (int) ny);
+                      (int) nx, (int) ny, tile, NULL, &par);
+        else
+            ssd_demosaicking_chain(redx, redy,
+                      data_in, data_in + nx * ny, data_in + 2 * nx * ny,
+                      data_out, data_out + nx * ny, data_out + 2 * nx * ny,
+                      (int) nx, (int) ny, NULL, &par);
+		
+        /* copy alpha channel */
+        memcpy(data_out + 3 * nx * ny, data_in + 3 * nx * ny,
+               nx * ny * sizeof(float));
+        free(data_in);
+    }
 	
     /* limit to 0-255 */
     out_ptr = data_out;
@@ -160,18 +249,10 @@ int main(int argc, char **argv)
 		out_ptr++;
     }
 	
-    /* copy alpha channel */
-    memcpy(data_out + 3 * nx * ny, data_in + 3 * nx * ny,
-		   nx * ny * sizeof(float));
-	
     /* TIFF RGBA float->8bit output */
     write_tiff_rgba_f32(argv[2], data_out, nx, ny);
 	
-    free(data_in);
     free(data_out);
 	
     return EXIT_SUCCESS;
 }
-
-
-
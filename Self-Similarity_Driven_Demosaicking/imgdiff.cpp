@@ -54,6 +54,7 @@ int main(int argc, char **argv)
     float scale, tmp;
 	int i, c;
 	float sdif[3];
+	float mse;
 	
     /* "-v" option : version info */
     if (2 <= argc && 0 == strcmp("-v", argv[1]))
@@ -134,6 +135,13 @@ int main(int argc, char **argv)
 		}
 		
 		printf("Root Mean Square Error (R,G,B) = (%2.2f, %2.2f, %2.2f)\n", sdif[0], sdif[1], sdif[2]);
+		
+		/* PSNR of the mean square error of the three channels */
+		mse = (sdif[0] * sdif[0] + sdif[1] * sdif[1] + sdif[2] * sdif[2]) / 3.0f;
+		if (0 < mse)
+			printf("PSNR = %2.2f dB\n", 10.0 * log10(255.0 * 255.0 / mse));
+		else
+			printf("PSNR = inf\n");
 
 	}
 	
@@ -0,0 +1,86 @@
+/*
+ * Copyright 2009, 2010 IPOL Image Processing On Line 
+ *  <http://www.ipol.im/>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdio.h>
+
+#include "io_raw.h"
+
+
+/**
+ * @brief load a raw dump as a float array
+ *
+ * The array is allocated in this function call. The samples are read
+ * line by line and scaled from [0, 2^bits - 1] to [0,255].
+ *
+ * @param fname the file name to read
+ * @param nx, ny image size
+ * @param bits number of significant bits of the samples, from 1 to 16
+ *
+ * @return the data array pointer, NULL if an error occured or if the
+ * file is too short
+ */
+float *read_raw_gray_f32(const char *fname, size_t nx, size_t ny, int bits)
+{
+    FILE *fp = NULL;
+    size_t bytes = (8 >= bits) ? 1 : 2;
+    float scale;
+    unsigned char *line = NULL;
+    float *data = NULL;
+    size_t i, j;
+
+    if (1 > bits || 16 < bits || 0 == nx || 0 == ny)
+        return NULL;
+    scale = 255.0f / (float) ((1 << bits) - 1);
+
+    /* open the file, allocate the line buffer and the output array */
+    if (NULL == (fp = fopen(fname, "rb")))
+        return NULL;
+    if (NULL == (line = (unsigned char *) malloc(bytes * nx))
+        || NULL == (data = (float *) malloc(nx * ny * sizeof(float))))
+    {
+        free(line);
+        fclose(fp);
+        return NULL;
+    }
+
+    /* read the samples line by line */
+    for (j = 0; j < ny; j++)
+    {
+        float *ptr = data + j * nx;
+
+        if (nx != fread(line, bytes, nx, fp))
+        {
+            free(line);
+            free(data);
+            fclose(fp);
+            return NULL;
+        }
+        if (1 == bytes)
+            for (i = 0; i < nx; i++)
+                ptr[i] = scale * (float) line[i];
+        else
+            for (i = 0; i < nx; i++)
+                ptr[i] = scale * (float) (line[2 * i]
+                                          | (line[2 * i + 1] << 8));
+    }
+
+    free(line);
+    fclose(fp);
+    return data;
+}
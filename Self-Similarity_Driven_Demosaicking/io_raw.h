@@ -0,0 +1,32 @@
+/*
+ * Copyright 2009, 2010 IPOL Image Processing On Line 
+ *  <http://www.ipol.im/>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * @file io_raw.cpp
+ * @brief raw sensor dump input routine
+ *
+ * A raw dump is a single channel image without header: nx * ny
+ * samples, line by line, of 1 byte if the samples have at most 8 bits
+ * and of 2 bytes (little endian) otherwise.
+ */
+
+#include <stdlib.h>
+
+
+float *read_raw_gray_f32(const char *fname, size_t nx, size_t ny, int bits);
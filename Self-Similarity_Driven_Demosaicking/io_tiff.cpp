@@ -216,6 +216,92 @@ unsigned char *read_tiff_rgba_u8(const char *fname, size_t * nx, size_t * ny)
     return (unsigned char *) read_tiff_rgba(fname, nx, ny, DT_U8);
 }
 
+/**
+ * @brief load the data from a single channel TIFF image file as a
+ * float array
+ *
+ * The image must have one sample per pixel, of 8 or 16 bits, such as
+ * a Bayer mosaic. The array is allocated in this function call. The
+ * 16bit values are scaled to [0,255].
+ *
+ * @param fname the file name to read
+ * @param nx, ny storage space for the image size
+ *
+ * @return the data array pointer, NULL if an error occured or if the
+ * image is not a single channel 8bit or 16bit image
+ */
+float *read_tiff_gray_f32(const char *fname, size_t * nx, size_t * ny)
+{
+    TIFF *tiffp = NULL;
+    uint32 width = 0, height = 0;
+    uint16 spp = 1, bps = 8, config = PLANARCONFIG_CONTIG;
+    unsigned char *line = NULL;
+    float *data = NULL;
+    uint32 i, j;
+
+    /* no warning messages */
+    (void) TIFFSetWarningHandler(NULL);
+
+    /* open the TIFF file and structure */
+    if (NULL == (tiffp = TIFFOpen(fname, "r")))
+        return NULL;
+
+    /* read the image format, only 8bit and 16bit gray images */
+    if (1 != TIFFGetField(tiffp, TIFFTAG_IMAGEWIDTH, &width)
+        || 1 != TIFFGetField(tiffp, TIFFTAG_IMAGELENGTH, &height))
+    {
+        TIFFClose(tiffp);
+        return NULL;
+    }
+    TIFFGetFieldDefaulted(tiffp, TIFFTAG_SAMPLESPERPIXEL, &spp);
+    TIFFGetFieldDefaulted(tiffp, TIFFTAG_BITSPERSAMPLE, &bps);
+    TIFFGetFieldDefaulted(tiffp, TIFFTAG_PLANARCONFIG, &config);
+    if (1 != spp || (8 != bps && 16 != bps))
+    {
+        TIFFClose(tiffp);
+        return NULL;
+    }
+
+    /* allocate the line buffer and the output array */
+    if (NULL == (line = (unsigned char *) malloc(TIFFScanlineSize(tiffp)))
+        || NULL == (data = (float *) malloc((size_t) width * height
+                                            * sizeof(float))))
+    {
+        free(line);
+        TIFFClose(tiffp);
+        return NULL;
+    }
+
+    /* read the image data line by line */
+    for (j = 0; j < height; j++)
+    {
+        float *ptr = data + (size_t) j * width;
+
+        if (1 != TIFFReadScanline(tiffp, line, j, 0))
+        {
+            free(line);
+            free(data);
+            TIFFClose(tiffp);
+            return NULL;
+        }
+        if (8 == bps)
+            for (i = 0; i < width; i++)
+                ptr[i] = (float) line[i];
+        else
+            for (i = 0; i < width; i++)
+                ptr[i] = (float) ((uint16 *) line)[i] * 255.0f / 65535.0f;
+    }
+
+    if (NULL != nx)
+        *nx = (size_t) width;
+    if (NULL != ny)
+        *ny = (size_t) height;
+
+    free(line);
+    TIFFClose(tiffp);
+    return data;
+}
+
 /*
  * WRITE FUNCTIONS
  */
@@ -406,4 +492,66 @@ int write_tiff_rgba_u8(const char *fname, const unsigned char *data,
     return write_tiff_rgba(fname, (void *) data, nx, ny, DT_U8);
 }
 
+/**
+ * @brief save a float array into a single channel 8bit TIFF file
+ *
+ * @param fname TIFF file name
+ * @param data input array of float values supposed in [0,255]
+ * @param nx ny array size
+ *
+ * @return 0 if OK, != 0 if an error occured
+ */
+int write_tiff_gray_f32(const char *fname, const float *data,
+                        size_t nx, size_t ny)
+{
+    TIFF *tiffp = NULL;
+    unsigned char *line = NULL;
+    size_t i, j;
+
+    if (NULL == data
+        || 4294967295. < (double) nx || 4294967295. < (double) ny)
+        return -1;
 
+    /* no warning messages */
+    (void) TIFFSetWarningHandler(NULL);
+
+    /* open the TIFF file and structure */
+    if (NULL == (tiffp = TIFFOpen(fname, "w")))
+        return -1;
+
+    /* insert tags into the TIFF structure */
+    if (1 != TIFFSetField(tiffp, TIFFTAG_IMAGEWIDTH, nx)
+        || 1 != TIFFSetField(tiffp, TIFFTAG_IMAGELENGTH, ny)
+        || 1 != TIFFSetField(tiffp, TIFFTAG_ORIENTATION, ORIENTATION_TOPLEFT)
+        || 1 != TIFFSetField(tiffp, TIFFTAG_BITSPERSAMPLE, 8)
+        || 1 != TIFFSetField(tiffp, TIFFTAG_SAMPLESPERPIXEL, 1)
+        || 1 != TIFFSetField(tiffp, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG)
+        || 1 != TIFFSetField(tiffp, TIFFTAG_PHOTOMETRIC,
+                             PHOTOMETRIC_MINISBLACK)
+        || 1 != TIFFSetField(tiffp, TIFFTAG_COMPRESSION, COMPRESSION_LZW)
+        || NULL == (line = (unsigned char *) malloc(nx)))
+    {
+        TIFFClose(tiffp);
+        return -1;
+    }
+
+    /* write the image line by line, rounded and limited to [0,255] */
+    for (j = 0; j < ny; j++)
+    {
+        for (i = 0; i < nx; i++)
+        {
+            float v = data[j * nx + i];
+            line[i] = (unsigned char) (0 > v ? 0 : (255 < v ? 255 : v + .5));
+        }
+        if (1 != TIFFWriteScanline(tiffp, line, (uint32) j, 0))
+        {
+            free(line);
+            TIFFClose(tiffp);
+            return -1;
+        }
+    }
+
+    free(line);
+    TIFFClose(tiffp);
+    return 0;
+}
@@ -24,11 +24,12 @@
  * @author Nicolas Limare <nicolas.limare@cmla.ens-cachan.fr>
  *
  * @todo stdin/stdout handling
- * @todo simple RGB/grayscale version
  * @todo TIFF float version
  *
  * These routines focus on RGBA 8bit TIFF files. These files can be
- * read into or written from unsigned char or float arrays.
+ * read into or written from unsigned char or float arrays. Single
+ * channel 8bit or 16bit TIFF files (Bayer mosaics) can be read into,
+ * and 8bit ones written from, float arrays.
  */
 
 #include <stdlib.h>
@@ -48,6 +49,8 @@ float *read_tiff_rgba_f32(const char *fname, size_t *nx, size_t *ny);
 unsigned char *read_tiff_rgba_u8(const char *fname, size_t *nx, size_t *ny);
 int write_tiff_rgba_f32(const char *fname, const float *data, size_t nx, size_t ny);
 int write_tiff_rgba_u8(const char *fname, const unsigned char *data, size_t nx, size_t ny);
+float *read_tiff_gray_f32(const char *fname, size_t *nx, size_t *ny);
+int write_tiff_gray_f32(const char *fname, const float *data, size_t nx, size_t ny);
 
 
 
@@ -19,6 +19,8 @@
 
 #include "libAuxiliary.h"
 
+#include <algorithm>
+
 /**
  * @file   libAuxiliary.cpp
  * @brief  Standard functions used by demosaicking algorithms
@@ -219,9 +221,158 @@ float l2_distance_r1(float *u0, int i0, int j0, int i1,
 
 
 
+// Compare and exchange two values: a <- min, b <- max
+#define MEDIAN_SORT(a,b) { float t_ = MIN(a,b); (b) = MAX(a,b); (a) = t_; }
+
+
+
+/**
+ * \brief  Median of the 3x3 neighbourhoods of the interior pixels of a row
+ *
+ * The median of 9 values is computed by a fixed network of 19 compare and exchange operations,
+ * without branches, so the loop on the pixels of the row is vectorized.
+ * The value is the same as the central value of the sorted neighbourhood.
+ *
+ * @param[in]   r0, r1, r2  previous, current and next rows
+ * @param[out]  out  output row, pixels 1 to iWidth-2
+ * @param[in]   iWidth  width of the image
+ *
+ */
+
+static void wxMedian3x3Row(float *r0, float *r1, float *r2, float *out, int iWidth)
+{
+	
+	for(int x=1; x < iWidth-1; x++){
+		
+		float p0 = r0[x-1], p1 = r0[x], p2 = r0[x+1];
+		float p3 = r1[x-1], p4 = r1[x], p5 = r1[x+1];
+		float p6 = r2[x-1], p7 = r2[x], p8 = r2[x+1];
+		
+		MEDIAN_SORT(p1,p2); MEDIAN_SORT(p4,p5); MEDIAN_SORT(p7,p8);
+		MEDIAN_SORT(p0,p1); MEDIAN_SORT(p3,p4); MEDIAN_SORT(p6,p7);
+		MEDIAN_SORT(p1,p2); MEDIAN_SORT(p4,p5); MEDIAN_SORT(p7,p8);
+		MEDIAN_SORT(p0,p3); MEDIAN_SORT(p5,p8); MEDIAN_SORT(p4,p7);
+		MEDIAN_SORT(p3,p6); MEDIAN_SORT(p1,p4); MEDIAN_SORT(p2,p5);
+		MEDIAN_SORT(p4,p7); MEDIAN_SORT(p4,p2); MEDIAN_SORT(p6,p4);
+		MEDIAN_SORT(p4,p2);
+		
+		out[x] = p4;
+	}
+	
+}
+
+
+
+/**
+ * \brief  Median of the neighbourhood of pixel (x,y) given by a list of offsets
+ *
+ * The neighbours inside the image are gathered and the central value is selected (std::nth_element):
+ * the same value as after sorting the neighbourhood.
+ *
+ * @param[in]   rows  rows y-iRadius to y+iRadius of the image
+ * @param[in]   iRadius  radius of the neighbourhood in rows
+ * @param[in]   (x,y)  pixel
+ * @param[in]   offx, offy, iNeigSize  offsets of the neighbourhood and their number
+ * @param[in]   vector  auxiliary array of size iNeigSize
+ * @param[in]   iWidth, iHeight size of the image
+ *
+ */
+
+static float wxMedianPixel(float **rows, int iRadius, int x, int y, int *offx, int *offy, int iNeigSize, float *vector, int iWidth, int iHeight)
+{
+	int iCount=0;
+	
+	for(int k=0; k < iNeigSize; k++){
+		
+		int x0=x+offx[k];
+		int y0=y+offy[k];
+		
+		if (x0 >= 0 && y0 >= 0 && x0 < iWidth && y0 < iHeight) { 
+			
+			vector[iCount] = rows[iRadius+offy[k]][x0];
+			iCount++; 
+			
+		}
+	}
+	
+	std::nth_element(vector, vector + iCount / 2, vector + iCount);
+	
+	return vector[iCount / 2];
+}
+
+
+
+/**
+ * \brief  Median filter of one row
+ *
+ * When the circular window is the 3x3 square (sqrt(2) <= fRadius < 2, e.g. 1.5 in chromatic_median), 
+ * the interior pixels use the median network of wxMedian3x3Row. Otherwise, and on the boundaries, 
+ * the neighbourhood is gathered and its median selected. The result is the same as when sorting 
+ * each neighbourhood.
+ *
+ * @param[in]   rows  rows y-iRadius to y+iRadius of the input image, iRadius = (int) (fRadius+1), 
+ *                    the rows outside the image are not used
+ * @param[out]  out  output row
+ * @param[in]   y  row
+ * @param[in]  fRadius window of size (2*fRadius+1) x (2*fRadius+1)
+ * @param[in]  iWidth, iHeight size of the image
+ *
+ */
+
+void wxMedianRow(float **rows, float *out, int y, float fRadius, int iWidth, int iHeight)
+{
+	
+	int iRadius = (int)(fRadius+1.0);
+	int iMaxSize = (2*iRadius+1)*(2*iRadius+1);
+	float fRadiusSqr = fRadius * fRadius;
+	
+	
+	// Offsets of the spatial neighborhood of radius fRadius
+	int *offx = new int[iMaxSize];
+	int *offy = new int[iMaxSize];
+	int iNeigSize = 0;
+	
+	for(int i=-iRadius;i<=iRadius;i++)
+		for(int j=-iRadius;j<=iRadius;j++)
+			if ((float) (i*i + j*j) <= fRadiusSqr){
+				
+				offx[iNeigSize] = i;
+				offy[iNeigSize] = j;
+				iNeigSize++;
+				
+			}
+	
+	// Vector to store values of each pixel neighborhood
+	float *vector = new float[iNeigSize];
+	
+	
+	// The neighborhood is the 3x3 square
+	if (iNeigSize == 9 && fRadiusSqr >= 2.0f && y > 0 && y < iHeight-1 && iWidth > 2) {
+		
+		wxMedian3x3Row(rows[iRadius-1], rows[iRadius], rows[iRadius+1], out, iWidth);
+		
+		out[0] = wxMedianPixel(rows, iRadius, 0, y, offx, offy, iNeigSize, vector, iWidth, iHeight);
+		out[iWidth-1] = wxMedianPixel(rows, iRadius, iWidth-1, y, offx, offy, iNeigSize, vector, iWidth, iHeight);
+		
+	} else {
+		
+		for(int x=0;x < iWidth;x++)
+			out[x] = wxMedianPixel(rows, iRadius, x, y, offx, offy, iNeigSize, vector, iWidth, iHeight);
+		
+	}
+	
+	delete[] vector;
+	delete[] offx;
+	delete[] offy;
+	
+}
+
+
+
 /**
  * \brief  Sliding window iterated median filter
  *
+ * The image is processed row by row by wxMedianRow (in parallel with OpenMP).
  *
  * @param[in]   u  input image
  * @param[out]  v  output image
@@ -239,51 +390,40 @@ void wxMedian(float *u,float *v, float fRadius, int inIter, int iWidth,int iHeig
     
 	
 	int iRadius = (int)(fRadius+1.0);
-	int iNeigSize = (2*iRadius+1)*(2*iRadius+1);
-	float fRadiusSqr = fRadius * fRadius;
-	
 	
-	// Vector to store values of each pixel neighborhood
-	float * vector = new float[iNeigSize];
 	
 	// For each iteration
 	for(int n = 0;  n < inIter; n++){
 		
-		// For each pixel
-		for(int x=0;x < iWidth;x++)
+#pragma omp parallel
+		{
+			
+			// Rows of the neighborhood of the current row
+			float **rows = new float*[2*iRadius+1];
+			
+			
+			// For each row
+#pragma omp for schedule(static)
 			for(int y=0;y< iHeight;y++){
 				
-				// Take spatial neighborhood fo radius fRadius
-				int iCount=0;
-				for(int i=-iRadius;i<=iRadius;i++)
-					for(int j=-iRadius;j<=iRadius;j++)
-						if ((float) (i*i + j*j) <= fRadiusSqr){
-							
-							int x0=x+i;
-							int y0=y+j;
-							
-							if (x0 >= 0 && y0 >= 0 && x0 < iWidth && y0 < iHeight) { 
-								
-								vector[iCount] = u[y0*iWidth+x0];
-								iCount++; 
-								
-							}
-							
-						}
-				
-				// order neighborhood values
-				QuickSortFloat(vector, iCount);
+				for(int k=0; k <= 2*iRadius; k++){
+					
+					int y0 = y-iRadius+k;
+					rows[k] = (y0 >= 0 && y0 < iHeight) ? u + y0*iWidth : NULL;
+				}
 				
-				v[y*iWidth+x] = vector[iCount / 2];
+				wxMedianRow(rows, v + y*iWidth, y, fRadius, iWidth, iHeight);
 				
 			}
+			
+			delete[] rows;
+			
+		}
 		
 		wxCopy(v,u,iWidth*iHeight);
 		
 	}
 	
-	delete[] vector;
-	
 }
 
 
@@ -171,6 +171,23 @@ void wxMedian(float *u,float *v, float fRadius, int inIter, int iWidth,int iHeig
 
 
 
+/**
+ * \brief  Median filter of one row
+ *
+ *
+ * @param[in]   rows  rows y-iRadius to y+iRadius of the input image, iRadius = (int) (fRadius+1), 
+ *                    the rows outside the image are not used
+ * @param[out]  out  output row
+ * @param[in]   y  row
+ * @param[in]  fRadius window of size (2*fRadius+1) x (2*fRadius+1)
+ * @param[in]  iWidth, iHeight size of the image
+ *
+ */
+
+void wxMedianRow(float **rows, float *out, int y, float fRadius, int iWidth, int iHeight);
+
+
+
 /**
  * \brief  Standard Quicksort. Orders float array in increasing order
  *
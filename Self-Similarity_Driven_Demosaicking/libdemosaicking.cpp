@@ -51,6 +51,30 @@
 #define BLUEPOSITION 2
 
 
+// rows processed together by demosaicking_nlmeans_sliding
+#define NL_BLOCK 8
+
+
+
+
+
+/**
+ * \brief  CFA position of a pixel, computed from the parities of its coordinates
+ *
+ * @param[in]  (x, y)  pixel
+ * @param[in]  (redx, redy)  coordinates of the red pixel: (0,0), (0,1), (1,0), (1,1)
+ * @return  REDPOSITION, GREENPOSITION or BLUEPOSITION
+ *
+ */
+
+static inline int cfa_position(int x, int y, int redx, int redy)
+{
+	if ((x&1) == redx && (y&1) == redy) return REDPOSITION;
+	if ((x&1) != redx && (y&1) != redy) return BLUEPOSITION;
+	return GREENPOSITION;
+}
+
+
 
 
 /**
@@ -65,6 +89,39 @@
 
 
 
+/**
+ * \brief  Green of a pixel on the boundaries of the image for Adams-Hamilton
+ *
+ * A pixel which is not green is the average of four neighbouring green pixels: North, South, 
+ * East, West, taking a mirror symmetry at the boundaries.
+ *
+ * @param[in]  (x, y)  pixel
+ * @param[in]  (redx, redy)  coordinates of the red pixel: (0,0), (0,1), (1,0), (1,1)
+ * @param[in]  igreen  original cfa green channel
+ * @param[out] ogreen  interpolated green channel
+ * @param[in]  width, height size of the image
+ *
+ */
+
+static inline void adams_green_boundary(int x,int y,int redx,int redy,float *igreen,float *ogreen,int width,int height)
+{
+	
+	if (cfa_position(x,y,redx,redy) == GREENPOSITION) return;
+	
+	int gn, gs, ge, gw;
+	
+	if (y > 0)  gn = y-1;	else    gn = 1;
+	if (y < height-1)	gs = y+1;  else  gs = height - 2 ;
+	if (x < width-1)  ge = x+1;  else  ge = width-2;
+	if (x > 0) gw = x-1;	else  gw = 1;
+	
+	ogreen[y*width + x] = (igreen[gn*width + x] +  igreen[gs*width + x] + igreen[y*width + gw] +  igreen[y*width + ge])/ 4.0;
+	
+}
+
+
+
+
 /**
  * \brief  Classical Adams-Hamilton demosaicking algorithm
  *
@@ -91,106 +148,160 @@ void demosaicking_adams(float threshold, int redx,int redy,float *ired,float *ig
 	wxCopy(iblue,oblue,width*height);
 	
 	
-	// Initializations
-	int bluex = 1 - redx;
-	int bluey = 1 - redy;
-	
+	// The CFA position of a pixel is given by the parities of its coordinates (cfa_position).
+	// The green is only read at green positions and the red and blue at their own positions, 
+	// where the input and the output are equal: each row is interpolated from the input and 
+	// the rows are processed in parallel.
 	
-	// CFA Mask of color per pixel
-	unsigned char* mask = (unsigned char *) malloc(width*height*sizeof(unsigned char));
 	
-	for(int x=0;x<width;x++)
-		for(int y=0;y<height;y++){
+#pragma omp parallel for
+	for(int y=0;y<height;y++) {
+		
+		
+		// Interpolate the green channel by bilinear on the boundaries: 
+		// the three first and last rows and columns
+		if (y < 3 || y >= height - 3) {
 			
-			if (x%2 == redx && y%2 == redy) mask[y*width+x] = REDPOSITION;
-			else  if (x%2 == bluex && y%2 == bluey) mask[y*width+x] = BLUEPOSITION;
-			else 	mask[y*width+x] = GREENPOSITION;
+			for(int x=0;x<width;x++)
+				adams_green_boundary(x,y,redx,redy,igreen,ogreen,width,height);
 			
+			continue;
 		}
+		
+		for(int x=0;x<MIN(3,width);x++)
+			adams_green_boundary(x,y,redx,redy,igreen,ogreen,width,height);
+		
+		for(int x=MAX(width-3,3);x<width;x++)
+			adams_green_boundary(x,y,redx,redy,igreen,ogreen,width,height);
+		
+		
+		
+		// Interpolate the green by Adams algorithm inside the image    
+		// First interpolate green directionally
+		// The non green pixels of the row are red ones (row of the red pixel) or blue ones, the 
+		// pixels of parity xp. All the pixels of the row are computed, the green ones keeping 
+		// their value, so that the loop is vectorized.
+		float *ichannel = ((y&1) == redy) ? ired : iblue;
+		int xp = ((y&1) == redy) ? redx : 1 - redx;
+		
+		float *g = igreen + y*width;
+		float *gp1 = g + width;
+		float *gm1 = g - width;
+		float *c = ichannel + y*width;
+		float *cp2 = c + 2*width;
+		float *cm2 = c - 2*width;
+		float *og = ogreen + y*width;
+		
+		for(int x=3;x<width-3;x++) {
+			
+			// Compute vertical and horizontal gradients in the green channel
+			float adv = fabsf(gp1[x] - gm1[x]);
+			float adh = fabsf(g[x-1] - g[x+1]);
+			
+			// Compute the horizontal and vertical second derivatives of the channel of the pixel (red or blue)
+			float dh0 = 2.0 * c[x] - c[x+2] - c[x-2];	
+			float dv0 = 2.0 * c[x] - cp2[x] - cm2[x];
+			
+			// Add vertical and horizontal differences
+			adh = adh + fabsf(dh0);
+			adv = adv + fabsf(dv0);
+			
+			// Isotropic, horizontal and vertical averages
+			float iso = (gm1[x] +  gp1[x] +  g[x-1] + g[x+1]) /4.0 + (dh0 + dv0) / 8.0;
+			float hor = (g[x-1] + g[x+1])/2.0 + (dh0)/4.0;
+			float ver = (gp1[x] + gm1[x])/2.0 + (dv0)/4.0;
+			
+			// If vertical and horizontal differences are similar, isotropic average, 
+			// else average in the direction of the smaller differences
+			float value = g[x];
+			
+			if ( adv < adh ) value = ver;
+			if (adh < adv ) value = hor;
+			if (fabsf(adv - adh) < threshold) value = iso;
+			
+			og[x] = ((x&1) == xp) ? value : g[x];
+			
+		}
+		
+	}
 	
 	
+	// compute the bilinear on the differences of the red and blue with the already interpolated green
+	demosaicking_bilinear_red_blue(redx,redy,ored,ogreen,oblue,width,height);
 	
+}
+
+
+
+
+/**
+ * \brief  Bilinear interpolation of the differences of one channel (red or blue) with the green
+ *
+ * The samples of the channel are at the pixels (x,y) with x%2 == cx and y%2 == cy. The rows 
+ * without samples (of parity 1 - cy) are interpolated vertically and diagonally from the rows 
+ * of samples, then the rows of samples horizontally, the boundaries by mirror symmetry. 
+ * Each of the two steps processes the rows in parallel.
+ *
+ * @param[in,out]  channel  differences with the green channel 
+ * @param[in]  (cx, cy)  coordinates of the sample of the channel: (0,0), (0,1), (1,0), (1,1)
+ * @param[in]  width, height size of the image
+ *
+ */
+
+static void bilinear_differences(int cx,int cy,float *channel,int width,int height)
+{
 	
-	// Interpolate the green channel by bilinear on the boundaries  
-	// make the average of four neighbouring green pixels: Nourth, South, East, West
-	for(int x=0;x<width;x++)
-		for(int y=0;y<height;y++)
-			if ( (mask[y*width+ x] != GREENPOSITION) && (x < 3 || y < 3 || x>= width - 3 || y>= height - 3 )) { 
-				
-				
-				int gn, gs, ge, gw;
-				
-				if (y > 0)  gn = y-1;	else    gn = 1;
-				if (y < height-1)	gs = y+1;  else  gs = height - 2 ;
-				if (x < width-1)  ge = x+1;  else  ge = width-2;
-				if (x > 0) gw = x-1;	else  gw = 1;
-				
-				ogreen[y*width + x] = (ogreen[gn*width + x] +  ogreen[gs*width + x] + ogreen[y*width + gw] +  ogreen[y*width + ge])/ 4.0;
-				
-			}
-	
-	
-	
-	// Interpolate the green by Adams algorithm inside the image    
-	// First interpolate green directionally
-	for(int x=3;x<width-3;x++)
-		for(int y=3;y<height-3;y++)
-			if (mask[y*width+ x] != GREENPOSITION ) {  
-				
-				
-				int l = y*width+x;
-				int lp1 = (y+1)*width +x;
-				int lp2 = (y+2)*width +x;
-				int lm1 = (y-1)*width +x;
-				int lm2 = (y-2)*width +x;
-				
-				// Compute vertical and horizontal gradients in the green channel
-				float adv = fabsf(ogreen[lp1] - ogreen[lm1]);
-				float adh = fabsf(ogreen[l-1] - ogreen[l+1]);
-				float dh0, dv0;
-				
-				// If current pixel is blue, we compute the horizontal and vertical blue second derivatives
-				// else is red, we compute the horizontal and vertical red second derivatives
-				if (mask[l] == BLUEPOSITION){  
-					
-					dh0 = 2.0 * oblue[l] - oblue[l+2] - oblue[l-2];	
-					dv0 = 2.0 * oblue[l] - oblue[lp2] - oblue[lm2];
-					
-				} else { 			
-					
-					
-					dh0 = 2.0 * ored[l] - ored[l+2] - ored[l-2];	
-					dv0 = 2.0 * ored[l] - ored[lp2] - ored[lm2];
-					
-				}	
-				
-				// Add vertical and horizontal differences
-				adh = adh + fabsf(dh0);
-				adv = adv + fabsf(dv0);
-				
-				// If vertical and horizontal differences are similar, compute an isotropic average
-				if (fabsf(adv - adh) < threshold)
-					
-					ogreen[l] = (ogreen[lm1] +  ogreen[lp1] +  ogreen[l-1] + ogreen[l+1]) /4.0 + (dh0 + dv0) / 8.0;
-				
-				// Else If horizontal differences are smaller, compute horizontal average
-				else if (adh < adv )
-					
-					ogreen[l] = (ogreen[l-1] + ogreen[l+1])/2.0 + (dh0)/4.0;
-				
-				// Else If vertical differences are smaller, compute vertical average			
-				else if ( adv < adh ) 			
-					
-					ogreen[l] = (ogreen[lp1] + ogreen[lm1])/2.0 + (dv0)/4.0;
-				
-			}
-	
+	// Rows without samples: the pixels of the column of a sample (x%2 == cx) are the average 
+	// of north and south, the other ones of the four diagonal neighbours
+#pragma omp parallel for
+	for(int y=1-cy;y<height;y+=2) {
+		
+		// Compute north and south positions
+		// taking a mirror symmetry at the boundaries
+		int gn, gs;
+		if (y > 0)  gn = y-1;	else    gn = 1;
+		if (y < height-1)	gs = y+1;  else  gs = height - 2 ;
+		
+		float *n = channel + gn*width;
+		float *s = channel + gs*width;
+		float *o = channel + y*width;
+		
+		for(int x=1;x<width-1;x++) {
+			
+			float vertical = ( n[x] + s[x])/2.0;
+			float diagonal = (n[x+1] + n[x-1]  +  s[x+1] +  s[x-1])/4.0;
+			
+			o[x] = ((x&1) == cx) ? vertical : diagonal;
+			
+		}
+		
+		// first and last columns, taking a mirror symmetry
+		o[0] = (cx == 0) ? ( n[0] + s[0])/2.0 : (n[1] + n[1]  +  s[1] +  s[1])/4.0;
+		
+		if (width > 1) {
+			
+			int x = width-1;
+			o[x] = ((x&1) == cx) ? ( n[x] + s[x])/2.0 : (n[x-1] + n[x-1]  +  s[x-1] +  s[x-1])/4.0;
+		}
+		
+	}
 	
-	// compute the bilinear on the differences of the red and blue with the already interpolated green
-	demosaicking_bilinear_red_blue(redx,redy,ored,ogreen,oblue,width,height);
 	
+	// Rows of samples: the pixels between two samples are the average of west and east
+#pragma omp parallel for
+	for(int y=cy;y<height;y+=2) {
+		
+		float *o = channel + y*width;
+		
+		// first and last columns, taking a mirror symmetry
+		if (cx == 1) o[0] = ( o[1] + o[1])/2.0;
+		if (((width-1)&1) != cx) o[width-1] = ( o[width-2] + o[width-2])/2.0;
+		
+		for(int x=1+cx;x<width-1;x+=2)
+			o[x] = ( o[x+1] + o[x-1])/2.0;
+		
+	}
 	
-	free(mask);
 }
 
 
@@ -217,20 +328,8 @@ void demosaicking_bilinear_red_blue(int redx,int redy,float *ored,float *ogreen,
 	int bluey = 1 - redy;
 	
 	
-	// Mask of color per pixel
-	unsigned char* mask = (unsigned char *) malloc(width*height*sizeof(unsigned char));
-	
-	for(int x=0;x<width;x++)
-		for(int y=0;y<height;y++){
-			
-			if (x%2 == redx && y%2 == redy) mask[y*width+x] = REDPOSITION;
-			else  if (x%2 == bluex && y%2 == bluey) mask[y*width+x] = BLUEPOSITION;
-			else 	mask[y*width+x] = GREENPOSITION;
-			
-		}
-	
-	
 	// Compute the differences  
+#pragma omp parallel for
 	for(int i=0; i < width*height;i++){
 		
 		ored[i] -= ogreen[i];
@@ -241,68 +340,21 @@ void demosaicking_bilinear_red_blue(int redx,int redy,float *ored,float *ogreen,
 	
 	
 	// Interpolate the blue differences making the average of possible values depending on the CFA structure 
-	for(int x=0; x < width;x++)
-		for(int y=0; y < height;y++)
-			if (mask[y*width+x] != BLUEPOSITION){
-				
-				int gn, gs, ge, gw;
-				
-				// Compute north, south, west, east positions
-				// taking a mirror symmetry at the boundaries
-				if (y > 0)  gn = y-1;	else    gn = 1;
-				if (y < height-1)	gs = y+1;  else  gs = height - 2 ;
-				if (x < width-1)  ge = x+1;  else  ge = width-2;
-				if (x > 0) gw = x-1;	else  gw = 1;
-				
-				if (mask[y*width+x] == GREENPOSITION && y % 2 == bluey) 
-					oblue[y*width+x] = ( oblue[y*width+ge] + oblue[y*width+gw])/2.0;
-				else if (mask[y*width+x] == GREENPOSITION  && x % 2 == bluex) 
-					oblue[y*width+x] = ( oblue[gn*width+x] + oblue[gs*width+x])/2.0;
-				else {
-					oblue[y*width+x] =  (oblue[gn*width+ge] + oblue[gn*width + gw]  +  oblue[gs*width + ge] +  oblue[gs*width +gw])/4.0;		 
-				}
-				
-			}
-	
-	
+	bilinear_differences(bluex,bluey,oblue,width,height);
 	
 	
-	// Interpolate the blue differences making the average of possible values depending on the CFA structure
-	for(int x=0;x<width;x++)
-		for(int y=0;y<height;y++)
-			if (mask[y*width+x] != REDPOSITION){
-				
-				int gn, gs, ge, gw;
-				
-				// Compute north, south, west, east positions
-				// taking a mirror symmetry at the boundaries
-				if (y > 0)  gn = y-1;	else    gn = 1;
-				if (y < height-1)	gs = y+1;  else  gs = height - 2 ;
-				if (x < width-1)  ge = x+1;  else  ge = width-2;
-				if (x > 0) gw = x-1;	else  gw = 1;
-				
-				if (mask[y*width+x] == GREENPOSITION && y % 2 == redy) 
-					ored[y*width+x] = ( ored[y*width+ge] + ored[y*width+gw])/2.0;
-				else if (mask[y*width+x] == GREENPOSITION  && x % 2 == redx) 
-					ored[y*width+x] = ( ored[gn*width+x] + ored[gs*width+x])/2.0;
-				else {
-					ored[y*width+x] =  (ored[gn*width+ge] + ored[gn*width + gw]  +  ored[gs*width + ge] +  ored[gs*width +gw])/4.0;	 
-				}
-				
-			}
+	// Interpolate the red differences making the average of possible values depending on the CFA structure
+	bilinear_differences(redx,redy,ored,width,height);
 	
 	
 	// Make back the differences
+#pragma omp parallel for
 	for(int i=0;i<width*height;i++){
 		
 		ored[i] += ogreen[i];
 		oblue[i] += ogreen[i];
 	}
 	
-	
-	
-	free(mask);
-	
 }
 
 
@@ -331,24 +383,7 @@ void demosaicking_nlmeans(int bloc, float h,int redx,int redy,float *ired,float
 {
 	
 	
-	// Initializations
-	int bluex = 1 - redx;
-	int bluey = 1 - redy;
-
-	
-	
-	// CFA Mask of color per pixel
-	unsigned char *cfamask = new unsigned char[width*height];
-	
-	
-	for(int x=0;x<width;x++)
-		for(int y=0;y<height;y++){
-			
-			if (x%2 == redx && y%2 == redy) cfamask[y*width+x] = REDPOSITION;
-			else  if (x%2 == bluex && y%2 == bluey) cfamask[y*width+x] = BLUEPOSITION;
-			else 	cfamask[y*width+x] = GREENPOSITION;
-			
-		}
+	// The CFA position of a pixel is given by the parities of its coordinates (cfa_position)
 	
 	
 	wxCopy(ired,ored,width*height);
@@ -364,9 +399,20 @@ void demosaicking_nlmeans(int bloc, float h,int redx,int redy,float *ired,float
 	sFillLut(lut, luttaille);
 	
 	
+	// Channels indexed by their CFA position
+	float *input[3];
+	input[GREENPOSITION] = igreen;
+	input[REDPOSITION] = ired;
+	input[BLUEPOSITION] = iblue;
+	
+	
 	
 	
 	// for each pixel
+	// The rows are shared among the threads (OpenMP): each pixel only reads the input 
+	// planes and writes its own output values, so the result does not depend on the 
+	// number of threads. The dynamic schedule balances the shorter windows of the border rows.
+#pragma omp parallel for schedule(dynamic)
 	for(int y=2; y <height-2; y++)
 		for(int x=2; x<width-2; x++)
 		{
@@ -382,25 +428,34 @@ void demosaicking_nlmeans(int bloc, float h,int redx,int redy,float *ired,float
 			int jmax=MIN(y+bloc,height-2);
 			
 			
-			// auxiliary variables for computing average
-			float red=0.0;
-			float green=0.0;
-			float blue=0.0;
+			// CFA position of the current pixel
+			int c=cfa_position(x,y,redx,redy);
+			
 			
-			float rweight=0.0;
-			float gweight=0.0;
-			float bweight=0.0;
+			// auxiliary variables for computing average, indexed by the CFA position of the channel
+			float value[3]={0.0,0.0,0.0};
+			float weight[3]={0.0,0.0,0.0};
 			
 			
-			// for each pixel in the neighborhood
+			// for each pixel in the neighborhood: in each row, the pixels of the same parity 
+			// have the same CFA position, the two parities are visited in turn
 			for(int j=jmin;j<=jmax;j++)
-				for(int i=imin;i<=imax;i++) {
+				for(int p=0;p<2;p++) {
 					
-					// index of neighborhood pixel
-					int l0=j*width+i;
+					int i0=imin+p;
+					int c0=cfa_position(i0,j,redx,redy);
 					
 					// We only interpolate channels differents of the current pixel channel
-					if (cfamask[l]!=cfamask[l0]) {
+					if (c0 == c) continue;
+					
+					float *plane=input[c0];
+					float sum=value[c0];
+					float sumweight=weight[c0];
+					
+					for(int i=i0;i<=imax;i+=2) {
+						
+						// index of neighborhood pixel
+						int l0=j*width+i;
 						
 						
 						// Distances computed on color
@@ -418,45 +473,33 @@ void demosaicking_nlmeans(int bloc, float h,int redx,int redy,float *ired,float
 						// Compute weight
 						some= some / (27.0 * h);
 						
-						float weight = sLUT(some,lut);
+						float w = sLUT(some,lut);
 						
 						// Add pixel to corresponding channel average
-						
-						if (cfamask[l0] == GREENPOSITION)  {
-							
-							green += weight*igreen[l0];
-							gweight+= weight;
-							
-						} else if (cfamask[l0] == REDPOSITION) {
-							
-							red += weight*ired[l0];
-							rweight+= weight;
-							
-						} else {
-							
-							blue += weight*iblue[l0];
-							bweight+= weight;
-						}
+						sum += w*plane[l0];
+						sumweight += w;
 						
 					}
 					
+					value[c0]=sum;
+					weight[c0]=sumweight;
+					
 				}
 			
 			
 			// Set value to current pixel
-			if (cfamask[l] != GREENPOSITION && gweight > fTiny)  ogreen[l]  =   green / gweight; 
+			if (c != GREENPOSITION && weight[GREENPOSITION] > fTiny)  ogreen[l]  =   value[GREENPOSITION] / weight[GREENPOSITION]; 
 			else  ogreen[l] = igreen[l];
 			
-			if ( cfamask[l] != REDPOSITION && rweight > fTiny)  ored[l]  =  red / rweight ;
+			if ( c != REDPOSITION && weight[REDPOSITION] > fTiny)  ored[l]  =  value[REDPOSITION] / weight[REDPOSITION] ;
 			else    ored[l] = ired[l];
 			
-			if  (cfamask[l] != BLUEPOSITION && bweight > fTiny)   oblue[l] =  blue / bweight;
+			if  (c != BLUEPOSITION && weight[BLUEPOSITION] > fTiny)   oblue[l] =  value[BLUEPOSITION] / weight[BLUEPOSITION];
 			else  oblue[l] = iblue[l];
 			
 			
 		} 
 	
-	delete[] cfamask;
 	delete[] lut;
 	
 }
@@ -464,9 +507,218 @@ void demosaicking_nlmeans(int bloc, float h,int redx,int redy,float *ired,float
 
 
 
+/**
+ * \brief  NLmeans based demosaicking with shared patch distances
+ *
+ * Same weighted averages as demosaicking_nlmeans, visiting the neighbours by displacement (dx,dy) 
+ * instead of by pixel. For a displacement, the squared color difference between each pixel and its 
+ * displaced neighbour is computed once, and the 3x3 patch distances of a whole row are obtained 
+ * as a sum of three vertical sums, themselves sums of three rows of differences. 
+ * Each difference is then shared by the 9 patches containing it and by the three channels, 
+ * instead of the 27 products per neighbour of l2_distance_r1.
+ *
+ * The rows are processed by blocks of NL_BLOCK rows (in parallel with OpenMP), each block keeping 
+ * the channel averages of its pixels. The neighbours of a pixel are added in the same order as in 
+ * demosaicking_nlmeans; only the rounding of the distances differs.
+ *
+ * @param[in]  ired, igreen, iblue  initial demosaicked image
+ * @param[out] ored, ogreen, oblue  demosaicked output 
+ * @param[in]  (redx, redy)  coordinates of the red pixel: (0,0), (0,1), (1,0), (1,1)
+ * @param[in]  bloc  research block of size (2+bloc+1) x (2*bloc+1)
+ * @param[in]  h kernel bandwidth 
+ * @param[in]  width, height size of the image
+ * @param[in]  lut  table of Exp(-x) filled by sFillLut, or NULL to compute it
+ *
+ */
+
+
+void demosaicking_nlmeans_sliding(int bloc, float h,int redx,int redy,float *ired,float *igreen,float *iblue,float *ored,float *ogreen,float *oblue,int width,int height,float *lut)
+{
+	
+	
+	// The CFA position of a pixel is given by the parities of its coordinates (cfa_position)
+	
+	
+	wxCopy(ired,ored,width*height);
+	wxCopy(igreen,ogreen,width*height);
+	wxCopy(iblue,oblue,width*height);
+	
+	
+	
+	// Tabulate the function Exp(-x) for x>0, unless the table is given
+	float *ownlut = NULL;
+	
+	if (lut == NULL) {
+		
+		int luttaille = (int) (LUTMAX*LUTPRECISION);
+		lut = ownlut = new float[luttaille];
+		
+		sFillLut(lut, luttaille);
+	}
+	
+	
+	// Channels indexed by their CFA position
+	float *input[3];
+	input[GREENPOSITION] = igreen;
+	input[REDPOSITION] = ired;
+	input[BLUEPOSITION] = iblue;
+	
+	
+	
+#pragma omp parallel
+	{
+		
+		// squared differences of three consecutive rows, vertical sums and patch distances of a row
+		float *dist = new float[3*width];
+		float *column = new float[width];
+		float *patch = new float[width];
+		
+		// weighted sums and weights of each channel for the pixels of a block
+		float *value = new float[3*NL_BLOCK*width];
+		float *weight = new float[3*NL_BLOCK*width];
+		
+		
+#pragma omp for schedule(dynamic)
+		for(int y0=2; y0 < height-2; y0+=NL_BLOCK)
+		{
+			
+			int y1 = MIN(y0+NL_BLOCK, height-2);
+			
+			for(int k=0; k < 3*NL_BLOCK*width; k++) {
+				value[k] = 0.0;
+				weight[k] = 0.0;
+			}
+			
+			
+			// for each displacement, in the order of the neighbours in demosaicking_nlmeans
+			for(int dy=-bloc; dy<=bloc; dy++)
+				for(int dx=-bloc; dx<=bloc; dx++) {
+					
+					// Even displacements link pixels of the same channel
+					if (dx%2 == 0 && dy%2 == 0) continue;
+					
+					
+					// pixels of the block whose neighbour is in the learning zone
+					int ymin = MAX(y0, 1-dy);
+					int ymax = MIN(y1-1, height-2-dy);
+					int xmin = MAX(2, 1-dx);
+					int xmax = MIN(width-3, width-2-dx);
+					
+					if (ymin > ymax || xmin > xmax) continue;
+					
+					int shift = dy*width+dx;
+					
+					
+					for(int r=ymin-1; r <= ymax+1; r++) {
+						
+						// Squared color differences of row r
+						float *d = dist + (r%3)*width;
+						
+						for(int x=xmin-1; x <= xmax+1; x++) {
+							
+							int l=r*width+x;
+							
+							float dr = ired[l] - ired[l+shift];
+							float dg = igreen[l] - igreen[l+shift];
+							float db = iblue[l] - iblue[l+shift];
+							
+							d[x] = dr*dr + dg*dg + db*db;
+						}
+						
+						if (r < ymin+1) continue;
+						
+						
+						// Patch distances of row y, centered between the last three rows
+						int y = r-1;
+						
+						// summed in the order of the rows, so that the result does not depend on the position in the image
+						float *d0 = dist + ((y-1)%3)*width, *d1 = dist + (y%3)*width, *d2 = dist + ((y+1)%3)*width;
+						
+						for(int x=xmin-1; x <= xmax+1; x++)
+							column[x] = d0[x] + d1[x] + d2[x];
+						
+						for(int x=xmin; x <= xmax; x++)
+							patch[x] = column[x-1] + column[x] + column[x+1];
+						
+						
+						// Add the neighbours to the channel averages: the pixels of the same parity 
+						// and their neighbours have the same CFA positions, the two parities are visited in turn
+						for(int p=0; p < 2; p++) {
+							
+							int xs = xmin+p;
+							int c = cfa_position(xs,y,redx,redy);
+							int c0 = cfa_position(xs+dx,y+dy,redx,redy);
+							
+							// We only interpolate channels differents of the current pixel channel
+							if (c == c0) continue;
+							
+							float *plane = input[c0] + y*width + shift;
+							float *sum = value + c0*NL_BLOCK*width + (y-y0)*width;
+							float *sumweight = weight + c0*NL_BLOCK*width + (y-y0)*width;
+							
+							for(int x=xs; x <= xmax; x+=2) {
+								
+								float some = patch[x] / (27.0 * h);
+								
+								float w = sLUT(some,lut);
+								
+								sum[x] += w*plane[x];
+								sumweight[x] += w;
+							}
+						}
+						
+					}
+					
+				}
+			
+			
+			// Set value to the pixels of the block
+			for(int y=y0; y < y1; y++)
+				for(int x=2; x < width-2; x++) {
+					
+					int l=y*width+x;
+					int k=(y-y0)*width+x;
+					int c=cfa_position(x,y,redx,redy);
+					
+					int kg = GREENPOSITION*NL_BLOCK*width + k;
+					int kr = REDPOSITION*NL_BLOCK*width + k;
+					int kb = BLUEPOSITION*NL_BLOCK*width + k;
+					
+					if (c != GREENPOSITION && weight[kg] > fTiny)  ogreen[l]  =   value[kg] / weight[kg]; 
+					else  ogreen[l] = igreen[l];
+					
+					if ( c != REDPOSITION && weight[kr] > fTiny)  ored[l]  =  value[kr] / weight[kr] ;
+					else    ored[l] = ired[l];
+					
+					if  (c != BLUEPOSITION && weight[kb] > fTiny)   oblue[l] =  value[kb] / weight[kb];
+					else  oblue[l] = iblue[l];
+					
+				}
+			
+		}
+		
+		
+		delete[] dist;
+		delete[] column;
+		delete[] patch;
+		delete[] value;
+		delete[] weight;
+		
+	}
+	
+	delete[] ownlut;
+	
+}
+
+
+
+
 /**
  * \brief  Iterate median filter on chromatic components of the image
  *
+ * Each iteration streams through the image once: the rows are transformed to YUV into a rolling 
+ * window of 2*(int)(side+1)+1 rows, and each row is filtered, transformed back and projected as soon 
+ * as its window is complete. The input image is not modified.
  *
  * @param[in]  ired, igreen, iblue  initial  image
  * @param[in]  iter  number of iteracions
@@ -483,14 +735,20 @@ void chromatic_median(int iter,int redx,int redy,int projflag,float side,float *
 {
 	
 	
-	int size=height*width;
+	// The median of row y needs the chromatic components of rows y-radius to y+radius
+	int radius = (int)(side+1.0);
+	int nrows = 2*radius+1;
 	
-	// Auxiliary variables for computing chromatic components
-	float *y=new float[size];
-	float *u=new float[size];
-	float *v=new float[size];
-	float *u0=new float[size];
-	float *v0=new float[size];
+	
+	// Rolling window of YUV rows (row r is kept in slot r % nrows) and filtered chromatic components
+	float *y=new float[nrows*width];
+	float *u=new float[nrows*width];
+	float *v=new float[nrows*width];
+	float *u0=new float[width];
+	float *v0=new float[width];
+	
+	float **urows=new float*[nrows];
+	float **vrows=new float*[nrows];
 	
 	int bluex=1-redx;
 	int bluey=1-redy;
@@ -500,43 +758,70 @@ void chromatic_median(int iter,int redx,int redy,int projflag,float side,float *
 	for(int i=1;i<=iter;i++){
 		
 		
-		// Transform to YUV
-		wxRgb2Yuv(ired,igreen,iblue,y,u,v,width,height); 
-		
-		// Perform a Median on YUV component
-		wxMedian(u,u0,side,1 ,width,height); 
-		wxMedian(v,v0,side,1 ,width,height); 
-		
+		// The first iteration reads the input, the next ones filter the output in place: 
+		// a row is written after the last row of its window has been transformed to YUV
+		float *sred = (i == 1) ? ired : ored;
+		float *sgreen = (i == 1) ? igreen : ogreen;
+		float *sblue = (i == 1) ? iblue : oblue;
 		
-		// Transform back to RGB
-		wxYuv2Rgb(ored,ogreen,oblue,y,u0,v0,width,height); 
 		
-		// If projection flag activated put back original CFA values
-		if (projflag)
-		{
-		
-			for(int x=0;x<width;x++)
-				for(int y=0;y<height;y++){
-					
-					int l=y*width+x;
+		for(int r=0; r < height+radius; r++){
+			
+			
+			// Transform row r to YUV
+			if (r < height) {
+				
+				int s=(r%nrows)*width;
+				
+				wxRgb2Yuv(sred+r*width,sgreen+r*width,sblue+r*width,y+s,u+s,v+s,width,1); 
+			}
+			
+			
+			// Row whose window is complete
+			int ry = r-radius;
+			
+			if (ry < 0) continue;
+			
+			for(int k=0; k < nrows; k++){
+				
+				int r0 = ry-radius+k;
+				
+				urows[k] = (r0 >= 0 && r0 < height) ? u + (r0%nrows)*width : NULL;
+				vrows[k] = (r0 >= 0 && r0 < height) ? v + (r0%nrows)*width : NULL;
+			}
+			
+			
+			// Perform a Median on UV components
+			wxMedianRow(urows,u0,ry,side,width,height);
+			wxMedianRow(vrows,v0,ry,side,width,height);
+			
+			
+			// Transform back to RGB
+			int l=ry*width;
+			
+			wxYuv2Rgb(ored+l,ogreen+l,oblue+l,y+(ry%nrows)*width,u0,v0,width,1); 
+			
+			
+			// If projection flag activated put back original CFA values
+			if (projflag)
+			{
+				
+				for(int x=0;x<width;x++){
 					
-					if (x%2==redx && y%2==redy) ored[l]=ired[l];
+					if (x%2==redx && ry%2==redy) ored[l+x]=ired[l+x];
 					
-					else if (x%2==bluex && y%2==bluey) oblue[l]=iblue[l];
+					else if (x%2==bluex && ry%2==bluey) oblue[l+x]=iblue[l+x];
 					
-					else ogreen[l]=igreen[l];
+					else ogreen[l+x]=igreen[l+x];
 					
 				}
+				
+			}
 			
 		}
 		
-		
-		wxCopy(ored,ired,size);
-		wxCopy(ogreen,igreen,size);
-		wxCopy(oblue,iblue,size);
-		
 	}
-
+	
 	
 	// delete auxiliary memory
 	delete[] y;
@@ -544,12 +829,92 @@ void chromatic_median(int iter,int redx,int redy,int projflag,float side,float *
 	delete[] u0;
 	delete[] v;
 	delete[] v0;
+	delete[] urows;
+	delete[] vrows;
+	
+}
+
+
+
+
+
+
+
+/**
+ * \brief Parameters of a named preset of the demosaicking chain
+ *
+ * "reference": three passes, h = 16, 4, 1, 15x15 search window (the chain of the IPOL article)
+ * "balanced":  two passes, h = 4, 1, 7x7 search window
+ * "fast":      one pass, h = 2, 5x5 search window
+ *
+ * The three presets use the Adams-Hamilton threshold 2 and one iteration of the chromatic median 
+ * of radius 1.5 with projection on the CFA values. The reference preset uses demosaicking_nlmeans, 
+ * the other two demosaicking_nlmeans_sliding, which is faster but rounds the weights differently.
+ *
+ * @param[in]   name  name of the preset
+ * @param[out]  par   parameters
+ * @return  1 if the preset exists, 0 else
+ *
+ */
+
+int ssd_preset(const char *name, ssd_parameters *par)
+{
+	
+	par->threshold = 2.0;
+	par->side = 1.5;
+	par->iter = 1;
+	par->projflag = 1;
+	
+	if (strcmp(name, "reference") == 0) {
+		
+		par->passes = 3;
+		par->h[0] = 16.0;
+		par->h[1] = 4.0;
+		par->h[2] = 1.0;
+		par->dbloc = 7;
+		par->sliding = 0;
+		
+	} else if (strcmp(name, "balanced") == 0) {
+		
+		par->passes = 2;
+		par->h[0] = 4.0;
+		par->h[1] = 1.0;
+		par->dbloc = 3;
+		par->sliding = 1;
+		
+	} else if (strcmp(name, "fast") == 0) {
+		
+		par->passes = 1;
+		par->h[0] = 2.0;
+		par->dbloc = 2;
+		par->sliding = 1;
+		
+	} else return 0;
 	
+	return 1;
 }
 
 
 
 
+/**
+ * \brief Margin of the tiles of the demosaicking chain
+ *
+ * A pixel of the chain depends on the input pixels at distance 4 (Adams-Hamilton) plus, for each 
+ * pass, dbloc + 1 (NLmeans) and iter * (int) side (chromatic median). The margin is rounded up to 
+ * an even number (32 for the reference chain).
+ *
+ * @param[in]  par  parameters of the chain
+ *
+ */
+
+int ssd_halo(const ssd_parameters *par)
+{
+	int halo = 4 + par->passes * (par->dbloc + 1 + par->iter * (int) par->side);
+	
+	return halo + halo%2;
+}
+
 
 
 
@@ -573,54 +938,300 @@ void chromatic_median(int iter,int redx,int redy,int projflag,float side,float *
  *
  * Output <- u;
  *
+ * The number of passes, the values of h and the other parameters are given by par (see ssd_preset), 
+ * the reference chain above by default.
+ *
  *
  * @param[in]  ired, igreen, iblue  initial  image
  * @param[out] ored, ogreen, oblue  filtered output 
  * @param[in]  (redx, redy)  coordinates of the red pixel: (0,0), (0,1), (1,0), (1,1)
  * @param[in]  width, height size of the image
+ * @param[in]  lut  table of Exp(-x) filled by sFillLut, or NULL to compute it at each pass (only 
+ *                  used by the sliding NLmeans)
+ * @param[in]  par  parameters of the chain, or NULL for the reference chain
  *
  */
 
 
 
-void ssd_demosaicking_chain(int redx,int redy,float *ired,float *igreen,float *iblue,float *ored,float *ogreen,float *oblue,int width,int height)
+void ssd_demosaicking_chain(int redx,int redy,float *ired,float *igreen,float *iblue,float *ored,float *ogreen,float *oblue,int width,int height,float *lut,const ssd_parameters *par)
 {
 	
 	
+	ssd_parameters reference;
+	
+	if (par == NULL) {
+		
+		ssd_preset("reference", &reference);
+		par = &reference;
+	}
+	
+	
 	////////////////////////////////////////////// Process
 	
 	
+	demosaicking_adams(par->threshold,redx,redy,ired, igreen, iblue, ored, ogreen, oblue, width,height);
+	
+	
+	for(int p=0; p < par->passes; p++) {
+		
+		if (par->sliding)
+			demosaicking_nlmeans_sliding(par->dbloc,par->h[p],redx,redy,ored,ogreen,oblue,ired,igreen,iblue,width,height,lut);
+		else
+			demosaicking_nlmeans(par->dbloc,par->h[p],redx,redy,ored,ogreen,oblue,ired,igreen,iblue,width,height);
+		chromatic_median(par->iter,redx,redy,par->projflag,par->side,ired,igreen,iblue,ored,ogreen,oblue,width,height);
+		
+	}
+	
+	
+}
+
+
+
 
-	float h;
-	int dbloc = 7;
-	float side = 1.5;
-	int iter = 1;
-	int projflag = 1;  
-	float threshold = 2.0;
+
+/**
+ * \brief Allocate the buffers of the tiled demosaicking chain
+ *
+ * @param[out] ws  workspace
+ * @param[in]  tile  size of the tiles, rounded up to an even number
+ * @param[in]  par  parameters of the chain, or NULL for the reference chain
+ *
+ */
+
+void ssd_workspace_alloc(ssd_workspace *ws, int tile, const ssd_parameters *par)
+{
 	
+	if (par == NULL) ssd_preset("reference", &ws->par);
+	else ws->par = *par;
 	
-	demosaicking_adams(threshold,redx,redy,ired, igreen, iblue, ored, ogreen, oblue, width,height);
+	ws->tile = tile + tile%2;
 	
+	int halo = ssd_halo(&ws->par);
+	int bsize = (ws->tile + 2*halo) * (ws->tile + 2*halo);
+	ws->planes = new float[6*bsize];
 	
+	int luttaille = (int) (LUTMAX*LUTPRECISION);
+	ws->lut = new float[luttaille];
+	
+	sFillLut(ws->lut, luttaille);
+}
+
+
+
+
+/**
+ * \brief Free the buffers of the tiled demosaicking chain
+ *
+ * @param[in]  ws  workspace
+ *
+ */
+
+void ssd_workspace_free(ssd_workspace *ws)
+{
+	delete[] ws->planes;
+	delete[] ws->lut;
+	
+	ws->planes = ws->lut = NULL;
+}
+
+
+
 
- 	h = 16.0;
-	demosaicking_nlmeans(dbloc,h,redx,redy,ored,ogreen,oblue,ired,igreen,iblue,width,height);
-	chromatic_median(iter,redx,redy,projflag,side,ired,igreen,iblue,ored,ogreen,oblue,width,height);
+/**
+ * \brief Demosaicking chain on tiles
+ *
+ * Common part of ssd_demosaicking_chain_tiled and ssd_demosaicking_chain_cfa: the input is either 
+ * three planes (ired, igreen, iblue) or, if cfa is not NULL, a single plane with the CFA samples, 
+ * distributed to the planes of each tile.
+ *
+ * Without workspace, the tiles are processed in parallel, each thread allocating its buffers. 
+ * With a workspace, they are processed by the calling thread in the buffers of the workspace, 
+ * with its size of tiles and parameters.
+ *
+ */
+
+static void ssd_demosaicking_tiles(int redx,int redy,float *ired,float *igreen,float *iblue,float *cfa,float *ored,float *ogreen,float *oblue,int width,int height,int tile,ssd_workspace *ws,const ssd_parameters *par)
+{
 	
+	ssd_parameters reference;
 	
+	if (ws != NULL) {
+		
+		tile = ws->tile;
+		par = &ws->par;
+		
+	} else if (par == NULL) {
+		
+		ssd_preset("reference", &reference);
+		par = &reference;
+	}
+	
+	tile += tile%2;
 	
- 	h = 4.0;
- 	demosaicking_nlmeans(dbloc,h,redx,redy,ored,ogreen,oblue,ired,igreen,iblue,width,height);
- 	chromatic_median(iter,redx,redy,projflag,side,ired,igreen,iblue,ored,ogreen,oblue,width,height);
- 	
- 	
+	int ntx = (width + tile - 1) / tile;
+	int nty = (height + tile - 1) / tile;
 	
- 	h = 1.0;
- 	demosaicking_nlmeans(dbloc,h,redx,redy,ored,ogreen,oblue,ired,igreen,iblue,width,height);
- 	chromatic_median(iter,redx,redy,projflag,side,ired,igreen,iblue,ored,ogreen,oblue,width,height);
+	int halo = ssd_halo(par);
+	int bsize = (tile + 2*halo) * (tile + 2*halo);
 	
 	
+#pragma omp parallel if (ws == NULL)
+	{
+		
+		// input and output planes of an extended tile and table of Exp(-x)
+		float *buffer, *lut;
+		
+		if (ws != NULL) {
+			
+			buffer = ws->planes;
+			lut = ws->lut;
+			
+		} else {
+			
+			int luttaille = (int) (LUTMAX*LUTPRECISION);
+			
+			buffer = new float[6*bsize];
+			lut = new float[luttaille];
+			
+			sFillLut(lut, luttaille);
+		}
+		
+		float *tred = buffer, *tgreen = buffer + bsize, *tblue = buffer + 2*bsize;
+		float *tored = buffer + 3*bsize, *togreen = buffer + 4*bsize, *toblue = buffer + 5*bsize;
+		
+		float *tinput[3];
+		tinput[GREENPOSITION] = tgreen;
+		tinput[REDPOSITION] = tred;
+		tinput[BLUEPOSITION] = tblue;
+		
+		
+#pragma omp for schedule(dynamic)
+		for(int t=0; t < ntx*nty; t++)
+		{
+			
+			// central part of the tile
+			int x0 = (t % ntx) * tile;
+			int y0 = (t / ntx) * tile;
+			int x1 = MIN(x0 + tile, width);
+			int y1 = MIN(y0 + tile, height);
+			
+			// extended tile
+			int ex0 = MAX(x0 - halo, 0);
+			int ey0 = MAX(y0 - halo, 0);
+			int ex1 = MIN(x1 + halo, width);
+			int ey1 = MIN(y1 + halo, height);
+			
+			int tw = ex1 - ex0;
+			int th = ey1 - ey0;
+			
+			
+			for(int y=ey0; y < ey1; y++) {
+				
+				int l = y*width + ex0;
+				int k = (y-ey0)*tw;
+				
+				if (cfa == NULL) {
+					
+					wxCopy(ired + l, tred + k, tw);
+					wxCopy(igreen + l, tgreen + k, tw);
+					wxCopy(iblue + l, tblue + k, tw);
+					
+				} else {
+					
+					// the values of the channels missing at a pixel are not used by the chain
+					for(int x=0; x < tw; x++) {
+						
+						tred[k+x] = tgreen[k+x] = tblue[k+x] = 0.0;
+						tinput[cfa_position(ex0+x,y,redx,redy)][k+x] = cfa[l+x];
+					}
+				}
+			}
+			
+			
+			ssd_demosaicking_chain(redx,redy,tred,tgreen,tblue,tored,togreen,toblue,tw,th,lut,par);
+			
+			
+			for(int y=y0; y < y1; y++) {
+				
+				int l = y*width + x0;
+				int k = (y-ey0)*tw + x0-ex0;
+				
+				wxCopy(tored + k, ored + l, x1-x0);
+				wxCopy(togreen + k, ogreen + l, x1-x0);
+				wxCopy(toblue + k, oblue + l, x1-x0);
+			}
+			
+		}
+		
+		if (ws == NULL) {
+			
+			delete[] buffer;
+			delete[] lut;
+		}
+		
+	}
 	
 }
 
 
+
+
+
+/**
+ * \brief Tiled demosaicking chain
+ *
+ * The image is cut into tiles of tile x tile pixels, each one extended by a margin of ssd_halo pixels 
+ * (clipped to the image), and ssd_demosaicking_chain is applied to each extended tile, whose central 
+ * part is written to the output. The margin covers the pixels the chain depends on, so the output is 
+ * the same as ssd_demosaicking_chain on the whole image: bitwise with IEEE arithmetic, up to the 
+ * last bits of a few values with -ffast-math, where the vectorized loops may round differently when 
+ * the tile width and the image width differ modulo the vector length. The tiles start at even 
+ * coordinates to keep the CFA configuration.
+ *
+ * The tiles are processed in parallel (OpenMP), each thread working in its own six planes of 
+ * (tile + 2 ssd_halo)^2 pixels, reused from one tile to the next: the working memory does not 
+ * depend on the size of the image, and the input image is not modified.
+ *
+ * @param[in]  ired, igreen, iblue  initial  image
+ * @param[out] ored, ogreen, oblue  filtered output 
+ * @param[in]  (redx, redy)  coordinates of the red pixel: (0,0), (0,1), (1,0), (1,1)
+ * @param[in]  width, height size of the image
+ * @param[in]  tile  size of the tiles, rounded up to an even number
+ * @param[in]  ws  workspace of the calling thread (tiles processed sequentially, size of its tiles), or NULL
+ * @param[in]  par  parameters of the chain (see ssd_preset) if there is no workspace, NULL for the reference chain
+ *
+ */
+
+
+void ssd_demosaicking_chain_tiled(int redx,int redy,float *ired,float *igreen,float *iblue,float *ored,float *ogreen,float *oblue,int width,int height,int tile,ssd_workspace *ws,const ssd_parameters *par)
+{
+	ssd_demosaicking_tiles(redx,redy,ired,igreen,iblue,NULL,ored,ogreen,oblue,width,height,tile,ws,par);
+}
+
+
+
+
+
+/**
+ * \brief Tiled demosaicking chain on a Bayer mosaic
+ *
+ * Same as ssd_demosaicking_chain_tiled, the input being a single plane with one CFA sample per 
+ * pixel: the three planes of a tile are filled from the mosaic, and only the output planes have 
+ * the size of the image.
+ *
+ * @param[in]  cfa  mosaic, sample of the channel given by the CFA configuration at each pixel
+ * @param[out] ored, ogreen, oblue  filtered output 
+ * @param[in]  (redx, redy)  coordinates of the red pixel: (0,0), (0,1), (1,0), (1,1)
+ * @param[in]  width, height size of the image
+ * @param[in]  tile  size of the tiles, rounded up to an even number
+ * @param[in]  ws  workspace of the calling thread (tiles processed sequentially, size of its tiles), or NULL
+ * @param[in]  par  parameters of the chain (see ssd_preset) if there is no workspace, NULL for the reference chain
+ *
+ */
+
+
+void ssd_demosaicking_chain_cfa(int redx,int redy,float *cfa,float *ored,float *ogreen,float *oblue,int width,int height,int tile,ssd_workspace *ws,const ssd_parameters *par)
+{
+	ssd_demosaicking_tiles(redx,redy,NULL,NULL,NULL,cfa,ored,ogreen,oblue,width,height,tile,ws,par);
+}
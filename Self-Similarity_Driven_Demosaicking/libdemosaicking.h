@@ -121,6 +121,27 @@ void demosaicking_nlmeans(int bloc, float h,int redx,int redy,float *ired,float
 
 
 
+/**
+ * \brief  NLmeans based demosaicking with shared patch distances
+ *
+ * Same as demosaicking_nlmeans, the 3x3 patch distances being computed by displacement 
+ * with sliding sums of the squared color differences.
+ *
+ * @param[in]  ired, igreen, iblue  initial demosaicked image
+ * @param[out] ored, ogreen, oblue  demosaicked output 
+ * @param[in]  (redx, redy)  coordinates of the red pixel: (0,0), (0,1), (1,0), (1,1)
+ * @param[in]  bloc  research block of size (2+bloc+1) x (2*bloc+1)
+ * @param[in]  h kernel bandwidth 
+ * @param[in]  width, height size of the image
+ * @param[in]  lut  table of Exp(-x) filled by sFillLut, or NULL to compute it
+ *
+ */
+
+
+void demosaicking_nlmeans_sliding(int bloc, float h,int redx,int redy,float *ired,float *igreen,float *iblue,float *ored,float *ogreen,float *oblue,int width,int height,float *lut=NULL);
+
+
+
 /**
  * \brief  Iterate median filter on chromatic components of the image
  *
@@ -142,6 +163,52 @@ void chromatic_median(int iter,int redx,int redy,int projflag,float side,float *
 
 
 
+/**
+ * \brief  Parameters of the demosaicking chain
+ */
+
+#define SSD_MAXPASSES 8
+
+struct ssd_parameters
+{
+	float threshold;			// threshold of Adams-Hamilton
+	int passes;					// number of NLmeans and chromatic median passes
+	float h[SSD_MAXPASSES];		// NLmeans kernel bandwidth of each pass
+	int dbloc;					// NLmeans research block of size (2*dbloc+1) x (2*dbloc+1)
+	float side;					// median in a (2*side+1) x (2*side+1) window
+	int iter;					// iterations of the chromatic median
+	int projflag;				// if not zero, values of the original CFA are kept
+	int sliding;				// if not zero, NLmeans with shared patch distances (demosaicking_nlmeans_sliding)
+};
+
+
+
+/**
+ * \brief Parameters of a named preset of the demosaicking chain
+ *
+ * "reference" (the chain of the IPOL article), "balanced" or "fast". The reference chain uses 
+ * demosaicking_nlmeans, the other presets demosaicking_nlmeans_sliding.
+ *
+ * @param[in]   name  name of the preset
+ * @param[out]  par   parameters
+ * @return  1 if the preset exists, 0 else
+ *
+ */
+
+int ssd_preset(const char *name, ssd_parameters *par);
+
+
+
+/**
+ * \brief Margin of the tiles of the demosaicking chain: distance of the input pixels a pixel 
+ * of the output depends on, rounded up to an even number
+ */
+
+int ssd_halo(const ssd_parameters *par);
+
+
+
+
 /**
  * \brief Demosaicking chain
  *
@@ -162,16 +229,86 @@ void chromatic_median(int iter,int redx,int redy,int projflag,float side,float *
  *
  * Output <- u;
  *
+ * The number of passes, the values of h and the other parameters are given by par (see ssd_preset), 
+ * the reference chain above by default.
+ *
  *
  * @param[in]  ired, igreen, iblue  initial  image
  * @param[out] ored, ogreen, oblue  filtered output 
  * @param[in]  (redx, redy)  coordinates of the red pixel: (0,0), (0,1), (1,0), (1,1)
  * @param[in]  width, height size of the image
+ * @param[in]  lut  table of Exp(-x) filled by sFillLut, or NULL to compute it at each pass (only 
+ *                  used by the sliding NLmeans)
+ * @param[in]  par  parameters of the chain, or NULL for the reference chain
+ *
+ */
+
+
+void ssd_demosaicking_chain(int redx,int redy,float *ired,float *igreen,float *iblue,float *ored,float *ogreen,float *oblue,int width,int height,float *lut=NULL,const ssd_parameters *par=NULL);
+
+
+
+
+/**
+ * \brief  Buffers of the tiled demosaicking chain for one thread, kept from one image to the next
+ */
+
+struct ssd_workspace
+{
+	int tile;			// size of the tiles
+	ssd_parameters par;	// parameters of the chain
+	float *planes;		// six planes of (tile + 2 ssd_halo)^2 pixels
+	float *lut;			// table of Exp(-x)
+};
+
+
+void ssd_workspace_alloc(ssd_workspace *ws, int tile, const ssd_parameters *par=NULL);
+
+void ssd_workspace_free(ssd_workspace *ws);
+
+
+
+/**
+ * \brief Tiled demosaicking chain
+ *
+ * Same output as ssd_demosaicking_chain, the chain being applied in parallel to tiles of 
+ * tile x tile pixels extended by a margin of ssd_halo pixels. The input image is not modified. 
+ * The output is bitwise identical with IEEE arithmetic; with -ffast-math a few values may differ 
+ * in their last bits, as the vectorized loops round differently on the tiles.
+ *
+ * @param[in]  ired, igreen, iblue  initial  image
+ * @param[out] ored, ogreen, oblue  filtered output 
+ * @param[in]  (redx, redy)  coordinates of the red pixel: (0,0), (0,1), (1,0), (1,1)
+ * @param[in]  width, height size of the image
+ * @param[in]  tile  size of the tiles
+ * @param[in]  ws  workspace of the calling thread (size of the tiles and parameters), or NULL
+ * @param[in]  par  parameters of the chain if there is no workspace, NULL for the reference chain
+ *
+ */
+
+
+void ssd_demosaicking_chain_tiled(int redx,int redy,float *ired,float *igreen,float *iblue,float *ored,float *ogreen,float *oblue,int width,int height,int tile,ssd_workspace *ws=NULL,const ssd_parameters *par=NULL);
+
+
+
+
+/**
+ * \brief Tiled demosaicking chain on a Bayer mosaic
+ *
+ * Same as ssd_demosaicking_chain_tiled, the input being a single plane with one CFA sample per pixel.
+ *
+ * @param[in]  cfa  mosaic, sample of the channel given by the CFA configuration at each pixel
+ * @param[out] ored, ogreen, oblue  filtered output 
+ * @param[in]  (redx, redy)  coordinates of the red pixel: (0,0), (0,1), (1,0), (1,1)
+ * @param[in]  width, height size of the image
+ * @param[in]  tile  size of the tiles
+ * @param[in]  ws  workspace of the calling thread (size of the tiles and parameters), or NULL
+ * @param[in]  par  parameters of the chain if there is no workspace, NULL for the reference chain
  *
  */
 
 
-void ssd_demosaicking_chain(int redx,int redy,float *ired,float *igreen,float *iblue,float *ored,float *ogreen,float *oblue,int width,int height);
+void ssd_demosaicking_chain_cfa(int redx,int redy,float *cfa,float *ored,float *ogreen,float *oblue,int width,int height,int tile,ssd_workspace *ws=NULL,const ssd_parameters *par=NULL);
 
 
 
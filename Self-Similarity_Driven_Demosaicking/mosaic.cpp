@@ -47,6 +47,7 @@ int main(int argc, char **argv)
     int mask_G[4] = {0, 0, 0, 0};
     int mask_B[4] = {0, 0, 0, 0};
     size_t i, j;
+    int gray = 0;
 
     /* version info */
     if (2 <= argc && 0 == strcmp("-v", argv[1]))
@@ -54,10 +55,17 @@ int main(int argc, char **argv)
         fprintf(stdout, "%s version " __DATE__ "\n", argv[0]);
         return EXIT_SUCCESS;
     }
+    /* single channel output */
+    if (2 <= argc && 0 == strcmp("-g", argv[1]))
+    {
+	gray = 1;
+	argv++;
+	argc--;
+    }
     /* sanity check */
     if (4 != argc)
     {
-        fprintf(stderr, "usage : %s input.tiff output.tiff pattern\n",
+        fprintf(stderr, "usage : %s [-g] input.tiff output.tiff pattern\n",
 		argv[0]);
         return EXIT_FAILURE;
     }
@@ -128,7 +136,15 @@ int main(int argc, char **argv)
 	    channel[i + nx * j] *= mask_B[(i % 2) + 2 * (j % 2)];
 
     /* output */
-    write_tiff_rgba_f32(argv[2], data, nx, ny);
+    if (gray)
+    {
+	/* one sample per pixel, the other channels being 0 */
+	for (i = 0; i < nx * ny; i++)
+	    data[i] += data[i + nx * ny] + data[i + 2 * nx * ny];
+	write_tiff_gray_f32(argv[2], data, nx, ny);
+    }
+    else
+	write_tiff_rgba_f32(argv[2], data, nx, ny);
 
     free(data);
 
@@ -99,6 +99,7 @@
 #include <math.h>
 #include <limits.h>
 #include <float.h>
+#include <string.h>
 #include "lsd.h"
 
 /** ln(10) */
@@ -144,9 +145,17 @@ struct coorlist
 };
 
 /*----------------------------------------------------------------------------*/
-/** A point (or pixel).
+/** A list of points (or pixels).
+
+    The coordinates are kept in two separate arrays, so the loops over
+    the points of a region read contiguous memory. The i-th point is
+    (reg->x[i],reg->y[i]).
  */
-struct point {int x,y;};
+struct point_list
+{
+  int * x;  /* x coordinates of the points */
+  int * y;  /* y coordinates of the points */
+};
 
 
 /*----------------------------------------------------------------------------*/
@@ -332,46 +341,53 @@ static void add_7tuple( ntuple_list out, double v1, double v2, double v3,
 /*----------------------------------------------------------------------------*/
 
 /*----------------------------------------------------------------------------*/
-/** char image data type
+/** bit image data type
 
+    Each pixel is a single bit, packed in words of type unsigned int.
     The pixel value at (x,y) is accessed by:
 
-      image->data[ x + y * image->xsize ]
+      get_bit( image, x + y * image->xsize )
 
     with x and y integer.
  */
-typedef struct image_char_s
+typedef struct image_bit_s
 {
-  unsigned char * data;
+  unsigned int * data;
   unsigned int xsize,ysize;
-} * image_char;
+} * image_bit;
+
+/** Number of pixels stored in each word of an image_bit. */
+#define BITS_PER_WORD ( CHAR_BIT * sizeof(unsigned int) )
 
 /*----------------------------------------------------------------------------*/
-/** Free memory used in image_char 'i'.
+/** Free memory used in image_bit 'i'.
  */
-static void free_image_char(image_char i)
+static void free_image_bit(image_bit i)
 {
   if( i == NULL || i->data == NULL )
-    error("free_image_char: invalid input image.");
+    error("free_image_bit: invalid input image.");
   free( (void *) i->data );
   free( (void *) i );
 }
 
 /*----------------------------------------------------------------------------*/
-/** Create a new image_char of size 'xsize' times 'ysize'.
+/** Create a new image_bit of size 'xsize' times 'ysize',
+    with all the pixels set to zero.
  */
-static image_char new_image_char(unsigned int xsize, unsigned int ysize)
+static image_bit new_image_bit(unsigned int xsize, unsigned int ysize)
 {
-  image_char image;
+  image_bit image;
+  size_t n_words;
 
   /* check parameters */
-  if( xsize == 0 || ysize == 0 ) error("new_image_char: invalid image size.");
+  if( xsize == 0 || ysize == 0 ) error("new_image_bit: invalid image size.");
 
   /* get memory */
-  image = (image_char) malloc( sizeof(struct image_char_s) );
+  n_words = ( (size_t) xsize * (size_t) ysize + BITS_PER_WORD - 1 )
+            / BITS_PER_WORD;
+  image = (image_bit) malloc( sizeof(struct image_bit_s) );
   if( image == NULL ) error("not enough memory.");
-  image->data = (unsigned char *) calloc( (size_t) (xsize*ysize),
-                                          sizeof(unsigned char) );
+  image->data = (unsigned int *) calloc( n_words, sizeof(unsigned int) );
   if( image->data == NULL ) error("not enough memory.");
 
   /* set image size */
@@ -382,24 +398,22 @@ static image_char new_image_char(unsigned int xsize, unsigned int ysize)
 }
 
 /*----------------------------------------------------------------------------*/
-/** Create a new image_char of size 'xsize' times 'ysize',
-    initialized to the value 'fill_value'.
+/** Get the value (0 or 1) of the pixel at address 'adr' of image_bit 'i'.
  */
-static image_char new_image_char_ini( unsigned int xsize, unsigned int ysize,
-                                      unsigned char fill_value )
+static int get_bit(image_bit i, unsigned int adr)
 {
-  image_char image = new_image_char(xsize,ysize); /* create image */
-  unsigned int N = xsize*ysize;
-  unsigned int i;
-
-  /* check parameters */
-  if( image == NULL || image->data == NULL )
-    error("new_image_char_ini: invalid image.");
+  return (int) ( ( i->data[adr/BITS_PER_WORD] >> (adr%BITS_PER_WORD) ) & 1u );
+}
 
-  /* initialize */
-  for(i=0; i<N; i++) image->data[i] = fill_value;
+/*----------------------------------------------------------------------------*/
+/** Set the pixel at address 'adr' of image_bit 'i' to 'value' (0 or 1).
+ */
+static void put_bit(image_bit i, unsigned int adr, int value)
+{
+  unsigned int mask = 1u << (adr % BITS_PER_WORD);
 
-  return image;
+  if( value ) i->data[adr / BITS_PER_WORD] |= mask;
+  else        i->data[adr / BITS_PER_WORD] &= ~mask;
 }
 
 /*----------------------------------------------------------------------------*/
@@ -507,29 +521,88 @@ static image_double new_image_double(unsigned int xsize, unsigned int ysize)
 }
 
 /*----------------------------------------------------------------------------*/
-/** Create a new image_double of size 'xsize' times 'ysize'
-    with the data pointed by 'data'.
+/** input image data type
+
+    A read-only view of an image provided by the caller, with pixels
+    of type 'type' (LSD_DOUBLE, LSD_FLOAT, LSD_UINT8 or LSD_UINT16).
+    The pixel value at (x,y) is stored at:
+
+      data[ x + y * image->stride ]
+
+    with x and y integer, so a sub-rectangle of a larger image can be
+    used without copying it. The data is never copied as a whole; rows
+    are converted to double when they are read, see input_row().
  */
-static image_double new_image_double_ptr( unsigned int xsize,
-                                          unsigned int ysize, double * data )
+typedef struct image_input_s
 {
-  image_double image;
+  const void * data;
+  int type;
+  unsigned int xsize,ysize;
+  size_t stride;
+} * image_input;
 
+/*----------------------------------------------------------------------------*/
+/** Set 'in' as a view of the caller's image data.
+ */
+static void set_image_input( image_input in, const void * data, int type,
+                             unsigned int xsize, unsigned int ysize,
+                             size_t stride )
+{
   /* check parameters */
-  if( xsize == 0 || ysize == 0 )
-    error("new_image_double_ptr: invalid image size.");
-  if( data == NULL ) error("new_image_double_ptr: NULL data pointer.");
+  if( in == NULL ) error("set_image_input: NULL image.");
+  if( data == NULL ) error("set_image_input: NULL data pointer.");
+  if( xsize == 0 || ysize == 0 ) error("set_image_input: invalid image size.");
+  if( stride < (size_t) xsize ) error("set_image_input: invalid row stride.");
+  if( type != LSD_DOUBLE && type != LSD_FLOAT &&
+      type != LSD_UINT8 && type != LSD_UINT16 )
+    error("set_image_input: unknown pixel type.");
+
+  in->data = data;
+  in->type = type;
+  in->xsize = xsize;
+  in->ysize = ysize;
+  in->stride = stride;
+}
 
-  /* get memory */
-  image = (image_double) malloc( sizeof(struct image_double_s) );
-  if( image == NULL ) error("not enough memory.");
+/*----------------------------------------------------------------------------*/
+/** Get row 'y' of input image 'in' as doubles.
 
-  /* set image */
-  image->xsize = xsize;
-  image->ysize = ysize;
-  image->data = data;
+    For LSD_DOUBLE images a pointer to the caller's data is returned.
+    Otherwise, the row is converted into 'buf', that must have room
+    for in->xsize values, and 'buf' is returned.
+ */
+static const double * input_row(image_input in, unsigned int y, double * buf)
+{
+  size_t offset = (size_t) y * in->stride;
+  unsigned int x;
 
-  return image;
+  switch( in->type )
+    {
+      case LSD_DOUBLE:
+        return (const double *) in->data + offset;
+      case LSD_FLOAT:
+        {
+          const float * row = (const float *) in->data + offset;
+          for(x=0; x<in->xsize; x++) buf[x] = (double) row[x];
+        }
+        break;
+      case LSD_UINT8:
+        {
+          const unsigned char * row = (const unsigned char *) in->data + offset;
+          for(x=0; x<in->xsize; x++) buf[x] = (double) row[x];
+        }
+        break;
+      case LSD_UINT16:
+        {
+          const unsigned short * row = (const unsigned short *) in->data
+                                       + offset;
+          for(x=0; x<in->xsize; x++) buf[x] = (double) row[x];
+        }
+        break;
+      default:
+        error("input_row: unknown pixel type.");
+    }
+  return buf;
 }
 
 
@@ -570,6 +643,17 @@ static void gaussian_kernel(ntuple_list kernel, double sigma, double mean)
   if( sum >= 0.0 ) for(i=0;i<kernel->dim;i++) kernel->values[i] /= sum;
 }
 
+/*----------------------------------------------------------------------------*/
+/** Size of an image side of 'size' pixels after scaling by 'scale'.
+ */
+static unsigned int scaled_size(unsigned int size, double scale)
+{
+  if( scale <= 0.0 ) error("scaled_size: 'scale' must be positive.");
+  if( size * scale > (double) UINT_MAX )
+    error("scaled_size: the output image size exceeds the handled size.");
+  return (unsigned int) ceil( size * scale );
+}
+
 /*----------------------------------------------------------------------------*/
 /** Scale the input image 'in' by a factor 'scale' by Gaussian sub-sampling.
 
@@ -607,15 +691,31 @@ static void gaussian_kernel(ntuple_list kernel, double sigma, double mean)
     The algorithm first applies a combined Gaussian kernel and sampling
     in the x axis, and then the combined Gaussian kernel and sampling
     in the y axis.
+
+    The input is read one row at a time with input_row(), so it may be
+    of any pixel type. The x axis pass is computed on demand for the
+    rows needed by the y axis pass and kept in a cache of 'n' rows,
+    where 'n' is the kernel size; when the output rows are computed in
+    order, each input row is filtered once. As the x axis kernels do
+    not depend on the row, they are computed once for each column.
+
+    The memory for the result is provided by the caller: 'out' must be
+    of size scaled_size(in->xsize,scale) times scaled_size(in->ysize,scale).
  */
-static image_double gaussian_sampler( image_double in, double scale,
-                                      double sigma_scale )
+static void gaussian_sampler( image_input in, double scale,
+                              double sigma_scale, image_double out )
 {
-  image_double aux,out;
   ntuple_list kernel;
-  unsigned int N,M,h,n,x,y,i;
+  unsigned int N,M,h,n,x,y,i,k,slot;
   int xc,yc,j,double_x_size,double_y_size;
   double sigma,xx,yy,sum,prec;
+  double * x_kernels;     /* x axis kernel for each output column */
+  int * x_index;          /* input column for each x axis kernel value */
+  double * in_row;        /* conversion buffer for one input row */
+  double * aux;           /* cache of x axis filtered rows */
+  int * aux_row;          /* input row stored in each cache slot */
+  double ** rows;         /* cache rows used for one output row */
+  const double * row;
 
   /* check parameters */
   if( in == NULL || in->data == NULL || in->xsize == 0 || in->ysize == 0 )
@@ -623,15 +723,14 @@ static image_double gaussian_sampler( image_double in, double scale,
   if( scale <= 0.0 ) error("gaussian_sampler: 'scale' must be positive.");
   if( sigma_scale <= 0.0 )
     error("gaussian_sampler: 'sigma_scale' must be positive.");
+  if( out == NULL || out->data == NULL )
+    error("gaussian_sampler: invalid output image.");
 
-  /* compute new image size and get memory for images */
-  if( in->xsize * scale > (double) UINT_MAX ||
-      in->ysize * scale > (double) UINT_MAX )
-    error("gaussian_sampler: the output image size exceeds the handled size.");
-  N = (unsigned int) ceil( in->xsize * scale );
-  M = (unsigned int) ceil( in->ysize * scale );
-  aux = new_image_double(N,in->ysize);
-  out = new_image_double(N,M);
+  /* compute new image size */
+  N = scaled_size(in->xsize,scale);
+  M = scaled_size(in->ysize,scale);
+  if( out->xsize != N || out->ysize != M )
+    error("gaussian_sampler: output image of wrong size.");
 
   /* sigma, kernel size and memory for the kernel */
   sigma = scale < 1.0 ? sigma_scale / scale : sigma_scale;
@@ -648,12 +747,24 @@ static image_double gaussian_sampler( image_double in, double scale,
   n = 1+2*h; /* kernel size */
   kernel = new_ntuple_list(n);
 
+  /* get memory for the x axis kernels and the row cache */
+  x_kernels = (double *) malloc( (size_t) N * n * sizeof(double) );
+  x_index = (int *) malloc( (size_t) N * n * sizeof(int) );
+  in_row = (double *) malloc( (size_t) in->xsize * sizeof(double) );
+  aux = (double *) malloc( (size_t) N * n * sizeof(double) );
+  aux_row = (int *) malloc( (size_t) n * sizeof(int) );
+  rows = (double **) malloc( (size_t) n * sizeof(double *) );
+  if( x_kernels == NULL || x_index == NULL || in_row == NULL ||
+      aux == NULL || aux_row == NULL || rows == NULL )
+    error("not enough memory.");
+  for(i=0;i<n;i++) aux_row[i] = -1; /* empty cache */
+
   /* auxiliary double image size variables */
   double_x_size = (int) (2 * in->xsize);
   double_y_size = (int) (2 * in->ysize);
 
-  /* First subsampling: x axis */
-  for(x=0;x<aux->xsize;x++)
+  /* x axis kernels */
+  for(x=0;x<N;x++)
     {
       /*
          x   is the coordinate in the new image.
@@ -668,25 +779,21 @@ static image_double gaussian_sampler( image_double in, double scale,
       /* the kernel must be computed for each x because the fine
          offset xx-xc is different in each case */
 
-      for(y=0;y<aux->ysize;y++)
+      for(i=0;i<n;i++)
         {
-          sum = 0.0;
-          for(i=0;i<kernel->dim;i++)
-            {
-              j = xc - h + i;
+          j = xc - h + i;
 
-              /* symmetry boundary condition */
-              while( j < 0 ) j += double_x_size;
-              while( j >= double_x_size ) j -= double_x_size;
-              if( j >= (int) in->xsize ) j = double_x_size-1-j;
+          /* symmetry boundary condition */
+          while( j < 0 ) j += double_x_size;
+          while( j >= double_x_size ) j -= double_x_size;
+          if( j >= (int) in->xsize ) j = double_x_size-1-j;
 
-              sum += in->data[ j + y * in->xsize ] * kernel->values[i];
-            }
-          aux->data[ x + y * aux->xsize ] = sum;
+          x_kernels[x*n+i] = kernel->values[i];
+          x_index[x*n+i] = j;
         }
     }
 
-  /* Second subsampling: y axis */
+  /* y axis, computing the x axis pass of the needed rows on demand */
   for(y=0;y<out->ysize;y++)
     {
       /*
@@ -702,29 +809,167 @@ static image_double gaussian_sampler( image_double in, double scale,
       /* the kernel must be computed for each y because the fine
          offset yy-yc is different in each case */
 
-      for(x=0;x<out->xsize;x++)
+      for(i=0;i<n;i++)
         {
-          sum = 0.0;
-          for(i=0;i<kernel->dim;i++)
-            {
-              j = yc - h + i;
+          j = yc - h + i;
 
-              /* symmetry boundary condition */
-              while( j < 0 ) j += double_y_size;
-              while( j >= double_y_size ) j -= double_y_size;
-              if( j >= (int) in->ysize ) j = double_y_size-1-j;
+          /* symmetry boundary condition */
+          while( j < 0 ) j += double_y_size;
+          while( j >= double_y_size ) j -= double_y_size;
+          if( j >= (int) in->ysize ) j = double_y_size-1-j;
 
-              sum += aux->data[ x + j * aux->xsize ] * kernel->values[i];
+          /* The rows used for one output row are all in a range of at
+             most n consecutive rows, so they never share a cache slot. */
+          slot = (unsigned int) j % n;
+          if( aux_row[slot] != j )
+            {
+              /* First subsampling: x axis */
+              row = input_row(in,(unsigned int) j,in_row);
+              for(x=0;x<N;x++)
+                {
+                  sum = 0.0;
+                  for(k=0;k<n;k++)
+                    sum += row[ x_index[x*n+k] ] * x_kernels[x*n+k];
+                  aux[ x + slot * N ] = sum;
+                }
+              aux_row[slot] = j;
             }
+          rows[i] = aux + slot * N;
+        }
+
+      /* Second subsampling: y axis */
+      for(x=0;x<out->xsize;x++)
+        {
+          sum = 0.0;
+          for(i=0;i<n;i++)
+            sum += rows[i][x] * kernel->values[i];
           out->data[ x + y * out->xsize ] = sum;
         }
     }
 
   /* free memory */
   free_ntuple_list(kernel);
-  free_image_double(aux);
+  free( (void *) x_kernels );
+  free( (void *) x_index );
+  free( (void *) in_row );
+  free( (void *) aux );
+  free( (void *) aux_row );
+  free( (void *) rows );
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*------------------------------- LSD workspace ------------------------------*/
+/*----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------*/
+/** Memory used by one execution of the detector.
+
+    All the images and lists needed to detect line segments are kept
+    together, so they can be allocated once and reused by several
+    executions, as done by the lsd_stream interface.
+
+    The buffers are allocated for the largest image to be processed,
+    and the 'xsize' and 'ysize' fields of the images are set at each
+    execution to the size actually used. 'max_size' is the number of
+    pixels available in each image. When the workspace is created for
+    scale=1.0, 'scaled' is not allocated and is NULL.
+ */
+struct lsd_workspace
+{
+  unsigned int max_size;        /* number of pixels in the images */
+  unsigned int n_bins;          /* number of bins in gradient ordering */
+  image_double scaled;          /* scaled image */
+  double * row_buf;             /* conversion buffer for two input rows */
+  image_double angles;          /* level-line angle at each pixel */
+  image_double modgrad;         /* gradient modulus at each pixel */
+  image_bit used;               /* pixels already used in a region */
+  struct point_list reg;        /* points of the region being grown */
+  struct coorlist * list;       /* memory for the ordered list of pixels */
+  struct coorlist ** range_l_s; /* array of pointers to start of bin list */
+  struct coorlist ** range_l_e; /* array of pointers to end of bin list */
+};
+
+/*----------------------------------------------------------------------------*/
+/** Free memory used by an LSD workspace.
+ */
+static void free_lsd_workspace(struct lsd_workspace * ws)
+{
+  if( ws == NULL ) error("free_lsd_workspace: invalid workspace.");
+  if( ws->scaled != NULL ) free_image_double(ws->scaled);
+  free( (void *) ws->row_buf );
+  free_image_double(ws->angles);
+  free_image_double(ws->modgrad);
+  free_image_bit(ws->used);
+  free( (void *) ws->reg.x );
+  free( (void *) ws->reg.y );
+  free( (void *) ws->list );
+  free( (void *) ws->range_l_s );
+  free( (void *) ws->range_l_e );
+  free( (void *) ws );
+}
+
+/*----------------------------------------------------------------------------*/
+/** Create an LSD workspace for input images of up to 'xsize' times
+    'ysize' pixels, processed at scale 'scale' with 'n_bins' bins in
+    the pseudo-ordering of gradient modulus.
+ */
+static struct lsd_workspace * new_lsd_workspace( unsigned int xsize,
+                                                 unsigned int ysize,
+                                                 double scale,
+                                                 unsigned int n_bins )
+{
+  struct lsd_workspace * ws;
+  unsigned int N,M;
+
+  /* check parameters */
+  if( xsize == 0 || ysize == 0 )
+    error("new_lsd_workspace: invalid image size.");
+  if( n_bins == 0 ) error("new_lsd_workspace: 'n_bins' must be positive.");
+
+  /* size of the images after scaling */
+  N = scaled_size(xsize,scale);
+  M = scaled_size(ysize,scale);
+
+  /* get memory */
+  ws = (struct lsd_workspace *) malloc( sizeof(struct lsd_workspace) );
+  if( ws == NULL ) error("not enough memory.");
+  ws->max_size = N * M;
+  ws->n_bins = n_bins;
+  ws->scaled = scale != 1.0 ? new_image_double(N,M) : NULL;
+  ws->row_buf = (double *) calloc( 2 * (size_t) N, sizeof(double) );
+  ws->angles = new_image_double(N,M);
+  ws->modgrad = new_image_double(N,M);
+  ws->used = new_image_bit(N,M);
+  ws->reg.x = (int *) calloc( (size_t) ws->max_size, sizeof(int) );
+  ws->reg.y = (int *) calloc( (size_t) ws->max_size, sizeof(int) );
+  ws->list = (struct coorlist *) calloc( (size_t) ws->max_size,
+                                         sizeof(struct coorlist) );
+  ws->range_l_s = (struct coorlist **) calloc( (size_t) n_bins,
+                                               sizeof(struct coorlist *) );
+  ws->range_l_e = (struct coorlist **) calloc( (size_t) n_bins,
+                                               sizeof(struct coorlist *) );
+  if( ws->row_buf == NULL ||
+      ws->reg.x == NULL || ws->reg.y == NULL || ws->list == NULL ||
+      ws->range_l_s == NULL || ws->range_l_e == NULL )
+    error("not enough memory.");
+
+  return ws;
+}
 
-  return out;
+/*----------------------------------------------------------------------------*/
+/** Set the size of a workspace image to 'xsize' times 'ysize',
+    that must fit in the 'max_size' pixels allocated for it.
+ */
+static void resize_workspace_image( image_double image, unsigned int xsize,
+                                    unsigned int ysize, unsigned int max_size )
+{
+  if( image == NULL || image->data == NULL )
+    error("resize_workspace_image: invalid image.");
+  if( xsize == 0 || ysize == 0 || (double) xsize * ysize > (double) max_size )
+    error("resize_workspace_image: the image does not fit in the workspace.");
+  image->xsize = xsize;
+  image->ysize = ysize;
 }
 
 
@@ -735,27 +980,31 @@ static image_double gaussian_sampler( image_double in, double scale,
 /*----------------------------------------------------------------------------*/
 /** Computes the direction of the level line of 'in' at each point.
 
-    The result is:
-    - an image_double with the angle at each pixel, or NOTDEF if not defined.
-    - the image_double 'modgrad' (a pointer is passed as argument)
-      with the gradient magnitude at each point.
+    The result is stored in the workspace 'ws':
+    - the image_double 'ws->angles' with the angle at each pixel,
+      or NOTDEF if not defined.
+    - the image_double 'ws->modgrad' with the gradient magnitude
+      at each point.
     - a list of pixels 'list_p' roughly ordered by decreasing
       gradient magnitude. (The order is made by classifying points
       into bins by gradient magnitude. The parameters 'n_bins' and
       'max_grad' specify the number of bins and the gradient modulus
       at the highest bin. The pixels in the list would be in
       decreasing gradient magnitude, up to a precision of the size of
-      the bins.)
-    - a pointer 'mem_p' to the memory used by 'list_p' to be able to
-      free the memory when it is not used anymore.
+      the bins.) The elements of the list are stored in 'ws->list'
+      and are valid until the workspace is used again.
  */
-static image_double ll_angle( image_double in, double threshold,
-                              struct coorlist ** list_p, void ** mem_p,
-                              image_double * modgrad, unsigned int n_bins )
+static void ll_angle( image_input in, double threshold,
+                      struct coorlist ** list_p, struct lsd_workspace * ws )
 {
-  image_double g;
-  unsigned int n,p,x,y,adr,i;
+  image_double g,modgrad;
+  unsigned int n,p,x,y,adr,i,n_bins;
   double com1,com2,gx,gy,norm,norm2;
+  const double * row0; /* input row y   */
+  const double * row1; /* input row y+1 */
+  double * buf0;
+  double * buf1;
+  double * swap;
   /* the rest of the variables are used for pseudo-ordering
      the gradient magnitude values */
   int list_count = 0;
@@ -771,79 +1020,85 @@ static image_double ll_angle( image_double in, double threshold,
     error("ll_angle: invalid image.");
   if( threshold < 0.0 ) error("ll_angle: 'threshold' must be positive.");
   if( list_p == NULL ) error("ll_angle: NULL pointer 'list_p'.");
-  if( mem_p == NULL ) error("ll_angle: NULL pointer 'mem_p'.");
-  if( modgrad == NULL ) error("ll_angle: NULL pointer 'modgrad'.");
-  if( n_bins == 0 ) error("ll_angle: 'n_bins' must be positive.");
+  if( ws == NULL ) error("ll_angle: NULL pointer 'ws'.");
 
   /* image size shortcuts */
   n = in->ysize;
   p = in->xsize;
 
-  /* allocate output image */
-  g = new_image_double(in->xsize,in->ysize);
-
-  /* get memory for the image of gradient modulus */
-  *modgrad = new_image_double(in->xsize,in->ysize);
-
-  /* get memory for "ordered" list of pixels */
-  list = (struct coorlist *) calloc( (size_t) (n*p), sizeof(struct coorlist) );
-  *mem_p = (void *) list;
-  range_l_s = (struct coorlist **) calloc( (size_t) n_bins,
-                                           sizeof(struct coorlist *) );
-  range_l_e = (struct coorlist **) calloc( (size_t) n_bins,
-                                           sizeof(struct coorlist *) );
-  if( list == NULL || range_l_s == NULL || range_l_e == NULL )
-    error("not enough memory.");
+  /* output images and ordered list of pixels, from the workspace */
+  g = ws->angles;
+  modgrad = ws->modgrad;
+  resize_workspace_image(g,p,n,ws->max_size);
+  resize_workspace_image(modgrad,p,n,ws->max_size);
+  list = ws->list;
+  range_l_s = ws->range_l_s;
+  range_l_e = ws->range_l_e;
+  n_bins = ws->n_bins;
   for(i=0;i<n_bins;i++) range_l_s[i] = range_l_e[i] = NULL;
 
-  /* 'undefined' on the down and right boundaries */
+  /* 'undefined' on the down and right boundaries,
+     where the workspace may hold values of a previous execution */
   for(x=0;x<p;x++) g->data[(n-1)*p+x] = NOTDEF;
   for(y=0;y<n;y++) g->data[p*y+p-1]   = NOTDEF;
+  for(x=0;x<p;x++) modgrad->data[(n-1)*p+x] = 0.0;
+  for(y=0;y<n;y++) modgrad->data[p*y+p-1]   = 0.0;
+
+  /* compute gradient on the remaining pixels, reading the input
+     one row at a time; each row is converted only once */
+  buf0 = ws->row_buf;
+  buf1 = ws->row_buf + p;
+  row1 = input_row(in,0,buf1);
+  for(y=0;y<n-1;y++)
+    {
+      /* row y+1 of this step becomes row y of the next one */
+      row0 = row1;
+      swap = buf0; buf0 = buf1; buf1 = swap;
+      row1 = input_row(in,y+1,buf1);
 
-  /* compute gradient on the remaining pixels */
-  for(x=0;x<p-1;x++)
-    for(y=0;y<n-1;y++)
-      {
-        adr = y*p+x;
-
-        /*
-           Norm 2 computation using 2x2 pixel window:
-             A B
-             C D
-           and
-             com1 = D-A,  com2 = B-C.
-           Then
-             gx = B+D - (A+C)   horizontal difference
-             gy = C+D - (A+B)   vertical difference
-           com1 and com2 are just to avoid 2 additions.
-         */
-        com1 = in->data[adr+p+1] - in->data[adr];
-        com2 = in->data[adr+1]   - in->data[adr+p];
-
-        gx = com1+com2; /* gradient x component */
-        gy = com1-com2; /* gradient y component */
-        norm2 = gx*gx+gy*gy;
-        norm = sqrt( norm2 / 4.0 ); /* gradient norm */
-
-        (*modgrad)->data[adr] = norm; /* store gradient norm */
-
-        if( norm <= threshold ) /* norm too small, gradient no defined */
-          g->data[adr] = NOTDEF; /* gradient angle not defined */
-        else
-          {
-            /* gradient angle computation */
-            g->data[adr] = atan2(gx,-gy);
+      for(x=0;x<p-1;x++)
+        {
+          adr = y*p+x;
+
+          /*
+             Norm 2 computation using 2x2 pixel window:
+               A B
+               C D
+             and
+               com1 = D-A,  com2 = B-C.
+             Then
+               gx = B+D - (A+C)   horizontal difference
+               gy = C+D - (A+B)   vertical difference
+             com1 and com2 are just to avoid 2 additions.
+           */
+          com1 = row1[x+1] - row0[x];
+          com2 = row0[x+1] - row1[x];
+
+          gx = com1+com2; /* gradient x component */
+          gy = com1-com2; /* gradient y component */
+          norm2 = gx*gx+gy*gy;
+          norm = sqrt( norm2 / 4.0 ); /* gradient norm */
+
+          modgrad->data[adr] = norm; /* store gradient norm */
+
+          if( norm <= threshold ) /* norm too small, gradient no defined */
+            g->data[adr] = NOTDEF; /* gradient angle not defined */
+          else
+            {
+              /* gradient angle computation */
+              g->data[adr] = atan2(gx,-gy);
 
-            /* look for the maximum of the gradient */
-            if( norm > max_grad ) max_grad = norm;
-          }
-      }
+              /* look for the maximum of the gradient */
+              if( norm > max_grad ) max_grad = norm;
+            }
+        }
+    }
 
   /* compute histogram of gradient values */
   for(x=0;x<p-1;x++)
     for(y=0;y<n-1;y++)
       {
-        norm = (*modgrad)->data[y*p+x];
+        norm = modgrad->data[y*p+x];
 
         /* store the point in the right bin according to its norm */
         i = (unsigned int) (norm * (double) n_bins / max_grad);
@@ -879,32 +1134,19 @@ static image_double ll_angle( image_double in, double threshold,
           }
       }
   *list_p = start;
-
-  /* free memory */
-  free( (void *) range_l_s );
-  free( (void *) range_l_e );
-
-  return g;
 }
 
 /*----------------------------------------------------------------------------*/
-/** Is point (x,y) aligned to angle theta, up to precision 'prec'?
+/** Is a point with level-line angle 'a' aligned to angle theta,
+    up to precision 'prec'?
+
+    This test is evaluated for every neighbor in region_grow() and for
+    every pixel in rect_nfa(), so it takes the angle value directly
+    instead of a point and an image. The callers are responsible for
+    reading 'a' inside the image and for 'prec' being positive.
  */
-static int isaligned( int x, int y, image_double angles, double theta,
-                      double prec )
+static int isaligned(double a, double theta, double prec)
 {
-  double a;
-
-  /* check parameters */
-  if( angles == NULL || angles->data == NULL )
-    error("isaligned: invalid image 'angles'.");
-  if( x < 0 || y < 0 || x >= (int) angles->xsize || y >= (int) angles->ysize )
-    error("isaligned: (x,y) out of the image.");
-  if( prec < 0.0 ) error("isaligned: 'prec' must be positive.");
-
-  /* angle at pixel (x,y) */
-  a = angles->data[ x + y * angles->xsize ];
-
   /* pixels whose level-line angle is not defined
      are considered as NON-aligned */
   if( a == NOTDEF ) return FALSE;  /* there is no need to call the function
@@ -1487,7 +1729,9 @@ static double rect_nfa(struct rect * rec, image_double angles, double logNT)
 
   /* check parameters */
   if( rec == NULL ) error("rect_nfa: invalid rectangle.");
-  if( angles == NULL ) error("rect_nfa: invalid 'angles'.");
+  if( angles == NULL || angles->data == NULL )
+    error("rect_nfa: invalid 'angles'.");
+  if( rec->prec < 0.0 ) error("rect_nfa: 'prec' must be positive.");
 
   /* compute the total number of pixels and of aligned points in 'rec' */
   for(i=ri_ini(rec); !ri_end(i); ri_inc(i)) /* rectangle iterator */
@@ -1495,7 +1739,8 @@ static double rect_nfa(struct rect * rec, image_double angles, double logNT)
         i->x < (int) angles->xsize && i->y < (int) angles->ysize )
       {
         ++pts; /* total number of pixels counter */
-        if( isaligned(i->x, i->y, angles, rec->theta, rec->prec) )
+        if( isaligned( angles->data[ i->x + i->y * angles->xsize ],
+                       rec->theta, rec->prec ) )
           ++alg; /* aligned points counter */
       }
   ri_del(i); /* delete iterator */
@@ -1565,8 +1810,9 @@ static double rect_nfa(struct rect * rec, image_double angles, double logNT)
     When |Ixx| > |Iyy| we use the first, otherwise the second (just to
     get better numeric precision).
  */
-static double get_theta( struct point * reg, int reg_size, double x, double y,
-                         image_double modgrad, double reg_angle, double prec )
+static double get_theta( struct point_list * reg, int reg_size,
+                         double x, double y, image_double modgrad,
+                         double reg_angle, double prec )
 {
   double lambda,theta,weight;
   double Ixx = 0.0;
@@ -1575,7 +1821,8 @@ static double get_theta( struct point * reg, int reg_size, double x, double y,
   int i;
 
   /* check parameters */
-  if( reg == NULL ) error("get_theta: invalid region.");
+  if( reg == NULL || reg->x == NULL || reg->y == NULL )
+    error("get_theta: invalid region.");
   if( reg_size <= 1 ) error("get_theta: region size <= 1.");
   if( modgrad == NULL || modgrad->data == NULL )
     error("get_theta: invalid 'modgrad'.");
@@ -1584,10 +1831,10 @@ static double get_theta( struct point * reg, int reg_size, double x, double y,
   /* compute inertia matrix */
   for(i=0; i<reg_size; i++)
     {
-      weight = modgrad->data[ reg[i].x + reg[i].y * modgrad->xsize ];
-      Ixx += ( (double) reg[i].y - y ) * ( (double) reg[i].y - y ) * weight;
-      Iyy += ( (double) reg[i].x - x ) * ( (double) reg[i].x - x ) * weight;
-      Ixy -= ( (double) reg[i].x - x ) * ( (double) reg[i].y - y ) * weight;
+      weight = modgrad->data[ reg->x[i] + reg->y[i] * modgrad->xsize ];
+      Ixx += ( (double) reg->y[i] - y ) * ( (double) reg->y[i] - y ) * weight;
+      Iyy += ( (double) reg->x[i] - x ) * ( (double) reg->x[i] - x ) * weight;
+      Ixy -= ( (double) reg->x[i] - x ) * ( (double) reg->y[i] - y ) * weight;
     }
   if( double_equal(Ixx,0.0) && double_equal(Iyy,0.0) && double_equal(Ixy,0.0) )
     error("get_theta: null inertia matrix.");
@@ -1608,7 +1855,7 @@ static double get_theta( struct point * reg, int reg_size, double x, double y,
 /*----------------------------------------------------------------------------*/
 /** Computes a rectangle that covers a region of points.
  */
-static void region2rect( struct point * reg, int reg_size,
+static void region2rect( struct point_list * reg, int reg_size,
                          image_double modgrad, double reg_angle,
                          double prec, double p, struct rect * rec )
 {
@@ -1616,7 +1863,8 @@ static void region2rect( struct point * reg, int reg_size,
   int i;
 
   /* check parameters */
-  if( reg == NULL ) error("region2rect: invalid region.");
+  if( reg == NULL || reg->x == NULL || reg->y == NULL )
+    error("region2rect: invalid region.");
   if( reg_size <= 1 ) error("region2rect: region size <= 1.");
   if( modgrad == NULL || modgrad->data == NULL )
     error("region2rect: invalid image 'modgrad'.");
@@ -1635,9 +1883,9 @@ static void region2rect( struct point * reg, int reg_size,
   x = y = sum = 0.0;
   for(i=0; i<reg_size; i++)
     {
-      weight = modgrad->data[ reg[i].x + reg[i].y * modgrad->xsize ];
-      x += (double) reg[i].x * weight;
-      y += (double) reg[i].y * weight;
+      weight = modgrad->data[ reg->x[i] + reg->y[i] * modgrad->xsize ];
+      x += (double) reg->x[i] * weight;
+      y += (double) reg->y[i] * weight;
       sum += weight;
     }
   if( sum <= 0.0 ) error("region2rect: weights sum equal to zero.");
@@ -1664,8 +1912,8 @@ static void region2rect( struct point * reg, int reg_size,
   l_min = l_max = w_min = w_max = 0.0;
   for(i=0; i<reg_size; i++)
     {
-      l =  ( (double) reg[i].x - x) * dx + ( (double) reg[i].y - y) * dy;
-      w = -( (double) reg[i].x - x) * dy + ( (double) reg[i].y - y) * dx;
+      l =  ( (double) reg->x[i] - x) * dx + ( (double) reg->y[i] - y) * dy;
+      w = -( (double) reg->x[i] - x) * dy + ( (double) reg->y[i] - y) * dx;
 
       if( l > l_max ) l_max = l;
       if( l < l_min ) l_min = l;
@@ -1700,53 +1948,84 @@ static void region2rect( struct point * reg, int reg_size,
 /*----------------------------------------------------------------------------*/
 /** Build a region of pixels that share the same angle, up to a
     tolerance 'prec', starting at point (x,y).
+
+    The 3x3 neighborhood of each region point is clipped to the image
+    before it is explored, so the inner loop only tests the 'used' bit
+    and the angle of each neighbor. The neighbors are explored in the
+    same order as before, as the region's angle is updated after each
+    new point and the result depends on that order.
+
+    For the same reason the alignment tests of a neighborhood are not
+    evaluated together: each one uses the region's angle left by the
+    previous accepted neighbor. The cost of this function is dominated
+    by the cos(), sin() and atan2() of that update, not by the memory
+    traffic, so the angles are kept in double precision (as the output
+    depends on them) and the coordinates in int arrays.
  */
-static void region_grow( int x, int y, image_double angles, struct point * reg,
-                         int * reg_size, double * reg_angle, image_char used,
-                         double prec )
+static void region_grow( int x, int y, image_double angles,
+                         struct point_list * reg, int * reg_size,
+                         double * reg_angle, image_bit used, double prec )
 {
-  double sumdx,sumdy;
-  int xx,yy,i;
+  double sumdx,sumdy,a;
+  int xx,yy,i,x_min,x_max,y_min,y_max,xsize,ysize;
+  unsigned int adr;
 
   /* check parameters */
-  if( x < 0 || y < 0 || x >= (int) angles->xsize || y >= (int) angles->ysize )
-    error("region_grow: (x,y) out of the image.");
   if( angles == NULL || angles->data == NULL )
     error("region_grow: invalid image 'angles'.");
-  if( reg == NULL ) error("region_grow: invalid 'reg'.");
+  if( x < 0 || y < 0 || x >= (int) angles->xsize || y >= (int) angles->ysize )
+    error("region_grow: (x,y) out of the image.");
+  if( reg == NULL || reg->x == NULL || reg->y == NULL )
+    error("region_grow: invalid 'reg'.");
   if( reg_size == NULL ) error("region_grow: invalid pointer 'reg_size'.");
   if( reg_angle == NULL ) error("region_grow: invalid pointer 'reg_angle'.");
-  if( used == NULL || used->data == NULL )
+  if( used == NULL || used->data == NULL ||
+      used->xsize != angles->xsize || used->ysize != angles->ysize )
     error("region_grow: invalid image 'used'.");
+  if( prec < 0.0 ) error("region_grow: 'prec' must be positive.");
+
+  /* image size shortcuts */
+  xsize = (int) angles->xsize;
+  ysize = (int) angles->ysize;
 
   /* first point of the region */
   *reg_size = 1;
-  reg[0].x = x;
-  reg[0].y = y;
-  *reg_angle = angles->data[x+y*angles->xsize];  /* region's angle */
+  reg->x[0] = x;
+  reg->y[0] = y;
+  *reg_angle = angles->data[x+y*xsize];  /* region's angle */
   sumdx = cos(*reg_angle);
   sumdy = sin(*reg_angle);
-  used->data[x+y*used->xsize] = USED;
+  put_bit(used,(unsigned int)(x+y*xsize),USED);
 
   /* try neighbors as new region points */
   for(i=0; i<*reg_size; i++)
-    for(xx=reg[i].x-1; xx<=reg[i].x+1; xx++)
-      for(yy=reg[i].y-1; yy<=reg[i].y+1; yy++)
-        if( xx>=0 && yy>=0 && xx<(int)used->xsize && yy<(int)used->ysize &&
-            used->data[xx+yy*used->xsize] != USED &&
-            isaligned(xx,yy,angles,*reg_angle,prec) )
+    {
+      /* neighborhood of point i, clipped to the image */
+      x_min = reg->x[i] > 0 ? reg->x[i]-1 : 0;
+      x_max = reg->x[i] < xsize-1 ? reg->x[i]+1 : xsize-1;
+      y_min = reg->y[i] > 0 ? reg->y[i]-1 : 0;
+      y_max = reg->y[i] < ysize-1 ? reg->y[i]+1 : ysize-1;
+
+      for(xx=x_min; xx<=x_max; xx++)
+        for(yy=y_min; yy<=y_max; yy++)
           {
+            adr = (unsigned int) (xx+yy*xsize);
+            if( get_bit(used,adr) == USED ) continue;
+            a = angles->data[adr];
+            if( !isaligned(a,*reg_angle,prec) ) continue;
+
             /* add point */
-            used->data[xx+yy*used->xsize] = USED;
-            reg[*reg_size].x = xx;
-            reg[*reg_size].y = yy;
+            put_bit(used,adr,USED);
+            reg->x[*reg_size] = xx;
+            reg->y[*reg_size] = yy;
             ++(*reg_size);
 
             /* update region's angle */
-            sumdx += cos( angles->data[xx+yy*angles->xsize] );
-            sumdy += sin( angles->data[xx+yy*angles->xsize] );
+            sumdx += cos(a);
+            sumdy += sin(a);
             *reg_angle = atan2(sumdy,sumdx);
           }
+    }
 }
 
 /*----------------------------------------------------------------------------*/
@@ -1866,17 +2145,18 @@ static double rect_improve( struct rect * rec, image_double angles,
     starting point, until that leads to rectangle with the right
     density of region points or to discard the region if too small.
  */
-static int reduce_region_radius( struct point * reg, int * reg_size,
+static int reduce_region_radius( struct point_list * reg, int * reg_size,
                                  image_double modgrad, double reg_angle,
                                  double prec, double p, struct rect * rec,
-                                 image_char used, image_double angles,
+                                 image_bit used, image_double angles,
                                  double density_th )
 {
   double density,rad1,rad2,rad,xc,yc;
   int i;
 
   /* check parameters */
-  if( reg == NULL ) error("reduce_region_radius: invalid pointer 'reg'.");
+  if( reg == NULL || reg->x == NULL || reg->y == NULL )
+    error("reduce_region_radius: invalid pointer 'reg'.");
   if( reg_size == NULL )
     error("reduce_region_radius: invalid pointer 'reg_size'.");
   if( prec < 0.0 ) error("reduce_region_radius: 'prec' must be positive.");
@@ -1894,8 +2174,8 @@ static int reduce_region_radius( struct point * reg, int * reg_size,
   if( density >= density_th ) return TRUE;
 
   /* compute region's radius */
-  xc = (double) reg[0].x;
-  yc = (double) reg[0].y;
+  xc = (double) reg->x[0];
+  yc = (double) reg->y[0];
   rad1 = dist( xc, yc, rec->x1, rec->y1 );
   rad2 = dist( xc, yc, rec->x2, rec->y2 );
   rad = rad1 > rad2 ? rad1 : rad2;
@@ -1907,13 +2187,14 @@ static int reduce_region_radius( struct point * reg, int * reg_size,
 
       /* remove points from the region and update 'used' map */
       for(i=0; i<*reg_size; i++)
-        if( dist( xc, yc, (double) reg[i].x, (double) reg[i].y ) > rad )
+        if( dist( xc, yc, (double) reg->x[i], (double) reg->y[i] ) > rad )
           {
             /* point not kept, mark it as NOTUSED */
-            used->data[ reg[i].x + reg[i].y * used->xsize ] = NOTUSED;
+            put_bit( used, (unsigned int) (reg->x[i] + reg->y[i] * used->xsize),
+                     NOTUSED );
             /* remove point from the region */
-            reg[i].x = reg[*reg_size-1].x; /* if i==*reg_size-1 copy itself */
-            reg[i].y = reg[*reg_size-1].y;
+            reg->x[i] = reg->x[*reg_size-1]; /* if i==*reg_size-1 copy itself */
+            reg->y[i] = reg->y[*reg_size-1];
             --(*reg_size);
             --i; /* to avoid skipping one point */
           }
@@ -1944,15 +2225,17 @@ static int reduce_region_radius( struct point * reg, int * reg_size,
     produce a rectangle with the right density of region points,
     'reduce_region_radius' is called to try to satisfy this condition.
  */
-static int refine( struct point * reg, int * reg_size, image_double modgrad,
-                   double reg_angle, double prec, double p, struct rect * rec,
-                   image_char used, image_double angles, double density_th )
+static int refine( struct point_list * reg, int * reg_size,
+                   image_double modgrad, double reg_angle, double prec,
+                   double p, struct rect * rec, image_bit used,
+                   image_double angles, double density_th )
 {
   double angle,ang_d,mean_angle,tau,density,xc,yc,ang_c,sum,s_sum;
   int i,n;
 
   /* check parameters */
-  if( reg == NULL ) error("refine: invalid pointer 'reg'.");
+  if( reg == NULL || reg->x == NULL || reg->y == NULL )
+    error("refine: invalid pointer 'reg'.");
   if( reg_size == NULL ) error("refine: invalid pointer 'reg_size'.");
   if( prec < 0.0 ) error("refine: 'prec' must be positive.");
   if( rec == NULL ) error("refine: invalid pointer 'rec'.");
@@ -1971,29 +2254,34 @@ static int refine( struct point * reg, int * reg_size, image_double modgrad,
   /*------ First try: reduce angle tolerance ------*/
 
   /* compute the new mean angle and tolerance */
-  xc = (double) reg[0].x;
-  yc = (double) reg[0].y;
-  ang_c = angles->data[ reg[0].x + reg[0].y * angles->xsize ];
+  xc = (double) reg->x[0];
+  yc = (double) reg->y[0];
+  ang_c = angles->data[ reg->x[0] + reg->y[0] * angles->xsize ];
+
+  /* the region is going to be grown again, release its points */
+  for(i=0; i<*reg_size; i++)
+    put_bit( used, (unsigned int) (reg->x[i] + reg->y[i] * used->xsize),
+             NOTUSED );
+
+  /* angle statistics of the points near the starting point;
+     the coordinate arrays are read sequentially */
   sum = s_sum = 0.0;
   n = 0;
   for(i=0; i<*reg_size; i++)
-    {
-      used->data[ reg[i].x + reg[i].y * used->xsize ] = NOTUSED;
-      if( dist( xc, yc, (double) reg[i].x, (double) reg[i].y ) < rec->width )
-        {
-          angle = angles->data[ reg[i].x + reg[i].y * angles->xsize ];
-          ang_d = angle_diff_signed(angle,ang_c);
-          sum += ang_d;
-          s_sum += ang_d * ang_d;
-          ++n;
-        }
-    }
+    if( dist( xc, yc, (double) reg->x[i], (double) reg->y[i] ) < rec->width )
+      {
+        angle = angles->data[ reg->x[i] + reg->y[i] * angles->xsize ];
+        ang_d = angle_diff_signed(angle,ang_c);
+        sum += ang_d;
+        s_sum += ang_d * ang_d;
+        ++n;
+      }
   mean_angle = sum / (double) n;
   tau = 2.0 * sqrt( (s_sum - 2.0 * mean_angle * sum) / (double) n
                          + mean_angle*mean_angle ); /* 2 * standard deviation */
 
   /* find a new region from the same starting point and new angle tolerance */
-  region_grow(reg[0].x,reg[0].y,angles,reg,reg_size,&reg_angle,used,tau);
+  region_grow(reg->x[0],reg->y[0],angles,reg,reg_size,&reg_angle,used,tau);
 
   /* if the region is too small, reject */
   if( *reg_size < 2 ) return FALSE;
@@ -2020,42 +2308,55 @@ static int refine( struct point * reg, int * reg_size, image_double modgrad,
 /*----------------------------------------------------------------------------*/
 
 /*----------------------------------------------------------------------------*/
-/** LSD full interface.
+/** Logarithm of the Number of Tests for an image of size 'xsize' times
+    'ysize', the size of the image used for the processing.
+
+    The theoretical number of tests is Np.(XY)^(5/2)
+    where X and Y are number of columns and rows of the image.
+    Np corresponds to the number of angle precisions considered.
+    As the procedure 'rect_improve' tests 5 times to halve the
+    angle precision, and 5 more times after improving other factors,
+    11 different precision values are potentially tested. Thus,
+    the number of tests is
+      11 * (X*Y)^(5/2)
+    whose logarithm value is
+      log10(11) + 5/2 * (log10(X) + log10(Y)).
  */
-double * LineSegmentDetection( int * n_out,
-                               double * img, int X, int Y,
-                               double scale, double sigma_scale, double quant,
-                               double ang_th, double log_eps, double density_th,
-                               int n_bins,
-                               int ** reg_img, int * reg_x, int * reg_y )
+static double log_nt(unsigned int xsize, unsigned int ysize)
 {
-  image_double image;
-  ntuple_list out = new_ntuple_list(7);
-  double * return_value;
-  image_double scaled_image,angles,modgrad;
-  image_char used;
-  image_int region = NULL;
+  return 5.0 * ( log10( (double) xsize ) + log10( (double) ysize ) ) / 2.0
+         + log10(11.0);
+}
+
+/*----------------------------------------------------------------------------*/
+/** Detect the line segments of 'image' using the memory of workspace 'ws'.
+
+    The detections are appended to the 7-tuple list 'out', in the
+    coordinates of 'image'. 'logNT' is the logarithm of the number of
+    tests, usually log_nt() of the processed image size. When 'region'
+    is not NULL, it must be an image of the size of the processed image
+    initialized to zero; each pixel of a detected line segment is set
+    to its position in 'out', numbered 1,2,3,...
+ */
+static void lsd_detect( struct lsd_workspace * ws, image_input image,
+                        double scale, double sigma_scale, double quant,
+                        double ang_th, double log_eps, double density_th,
+                        double logNT, ntuple_list out, image_int region )
+{
+  image_double angles,modgrad;
+  struct image_input_s scaled;
+  image_bit used;
   struct coorlist * list_p;
-  void * mem_p;
   struct rect rec;
-  struct point * reg;
+  struct point_list * reg;
   int reg_size,min_reg_size,i;
-  unsigned int xsize,ysize;
-  double rho,reg_angle,prec,p,log_nfa,logNT;
-  int ls_count = 0;                   /* line segments are numbered 1,2,3,... */
-
+  unsigned int xsize,ysize,n_words;
+  double rho,reg_angle,prec,p,log_nfa;
 
   /* check parameters */
-  if( img == NULL || X <= 0 || Y <= 0 ) error("invalid image input.");
-  if( scale <= 0.0 ) error("'scale' value must be positive.");
-  if( sigma_scale <= 0.0 ) error("'sigma_scale' value must be positive.");
-  if( quant < 0.0 ) error("'quant' value must be positive.");
-  if( ang_th <= 0.0 || ang_th >= 180.0 )
-    error("'ang_th' value must be in the range (0,180).");
-  if( density_th < 0.0 || density_th > 1.0 )
-    error("'density_th' value must be in the range [0,1].");
-  if( n_bins <= 0 ) error("'n_bins' value must be positive.");
-
+  if( ws == NULL ) error("lsd_detect: invalid workspace.");
+  if( image == NULL || image->data == NULL ) error("invalid image input.");
+  if( out == NULL || out->dim != 7 ) error("lsd_detect: invalid 'out'.");
 
   /* angle tolerance */
   prec = M_PI * ang_th / 180.0;
@@ -2063,51 +2364,47 @@ double * LineSegmentDetection( int * n_out,
   rho = quant / sin(prec); /* gradient magnitude threshold */
 
 
-  /* load and scale image (if necessary) and compute angle at each pixel */
-  image = new_image_double_ptr( (unsigned int) X, (unsigned int) Y, img );
+  /* scale image (if necessary) and compute angle at each pixel */
   if( scale != 1.0 )
     {
-      scaled_image = gaussian_sampler( image, scale, sigma_scale );
-      angles = ll_angle( scaled_image, rho, &list_p, &mem_p,
-                         &modgrad, (unsigned int) n_bins );
-      free_image_double(scaled_image);
+      if( ws->scaled == NULL )
+        error("lsd_detect: workspace was not created for scaling.");
+      xsize = scaled_size(image->xsize,scale);
+      ysize = scaled_size(image->ysize,scale);
+      resize_workspace_image(ws->scaled,xsize,ysize,ws->max_size);
+      gaussian_sampler( image, scale, sigma_scale, ws->scaled );
+      set_image_input( &scaled, ws->scaled->data, LSD_DOUBLE,
+                       xsize, ysize, (size_t) xsize );
+      ll_angle( &scaled, rho, &list_p, ws );
     }
   else
-    angles = ll_angle( image, rho, &list_p, &mem_p, &modgrad,
-                       (unsigned int) n_bins );
+    ll_angle( image, rho, &list_p, ws );
+  angles = ws->angles;
+  modgrad = ws->modgrad;
   xsize = angles->xsize;
   ysize = angles->ysize;
+  if( region != NULL && ( region->xsize != xsize || region->ysize != ysize ) )
+    error("lsd_detect: 'region' image of wrong size.");
 
-  /* Number of Tests - NT
-
-     The theoretical number of tests is Np.(XY)^(5/2)
-     where X and Y are number of columns and rows of the image.
-     Np corresponds to the number of angle precisions considered.
-     As the procedure 'rect_improve' tests 5 times to halve the
-     angle precision, and 5 more times after improving other factors,
-     11 different precision values are potentially tested. Thus,
-     the number of tests is
-       11 * (X*Y)^(5/2)
-     whose logarithm value is
-       log10(11) + 5/2 * (log10(X) + log10(Y)).
-  */
-  logNT = 5.0 * ( log10( (double) xsize ) + log10( (double) ysize ) ) / 2.0
-          + log10(11.0);
   min_reg_size = (int) (-logNT/log10(p)); /* minimal number of points in region
                                              that can give a meaningful event */
 
 
   /* initialize some structures */
-  if( reg_img != NULL && reg_x != NULL && reg_y != NULL ) /* save region data */
-    region = new_image_int_ini(angles->xsize,angles->ysize,0);
-  used = new_image_char_ini(xsize,ysize,NOTUSED);
-  reg = (struct point *) calloc( (size_t) (xsize*ysize), sizeof(struct point) );
-  if( reg == NULL ) error("not enough memory!");
+  used = ws->used;
+  used->xsize = xsize;
+  used->ysize = ysize;
+  n_words = (unsigned int) ( ( (size_t) xsize * ysize + BITS_PER_WORD - 1 )
+                             / BITS_PER_WORD );
+  /* all pixels NOTUSED */
+  memset( (void *) used->data, 0, n_words * sizeof(unsigned int) );
+  reg = &(ws->reg);
 
 
   /* search for line segments */
   for(; list_p != NULL; list_p = list_p->next )
-    if( used->data[ list_p->x + list_p->y * used->xsize ] == NOTUSED &&
+    if( get_bit( used, (unsigned int) (list_p->x + list_p->y * used->xsize) )
+          == NOTUSED &&
         angles->data[ list_p->x + list_p->y * angles->xsize ] != NOTDEF )
        /* there is no risk of double comparison problems here
           because we are only interested in the exact NOTDEF value */
@@ -2139,7 +2436,6 @@ double * LineSegmentDetection( int * n_out,
         if( log_nfa <= log_eps ) continue;
 
         /* A New Line Segment was found! */
-        ++ls_count;  /* increase line segment counter */
 
         /*
            The gradient was computed with a 2x2 mask, its value corresponds to
@@ -2164,19 +2460,66 @@ double * LineSegmentDetection( int * n_out,
         /* add region number to 'region' image if needed */
         if( region != NULL )
           for(i=0; i<reg_size; i++)
-            region->data[ reg[i].x + reg[i].y * region->xsize ] = ls_count;
+            region->data[ reg->x[i] + reg->y[i] * region->xsize ] =
+              (int) out->size;
       }
+}
+
+/*----------------------------------------------------------------------------*/
+/** LSD full interface for any pixel type and row stride.
+ */
+double * LineSegmentDetectionTyped( int * n_out,
+                                    const void * img, int type,
+                                    int X, int Y, int stride,
+                                    double scale, double sigma_scale,
+                                    double quant, double ang_th,
+                                    double log_eps, double density_th,
+                                    int n_bins,
+                                    int ** reg_img, int * reg_x, int * reg_y )
+{
+  struct image_input_s image;
+  ntuple_list out = new_ntuple_list(7);
+  double * return_value;
+  struct lsd_workspace * ws;
+  image_int region = NULL;
+  unsigned int xsize,ysize;
+
+
+  /* check parameters */
+  if( img == NULL || X <= 0 || Y <= 0 ) error("invalid image input.");
+  if( stride < X ) error("'stride' value must be at least X.");
+  if( scale <= 0.0 ) error("'scale' value must be positive.");
+  if( sigma_scale <= 0.0 ) error("'sigma_scale' value must be positive.");
+  if( quant < 0.0 ) error("'quant' value must be positive.");
+  if( ang_th <= 0.0 || ang_th >= 180.0 )
+    error("'ang_th' value must be in the range (0,180).");
+  if( density_th < 0.0 || density_th > 1.0 )
+    error("'density_th' value must be in the range [0,1].");
+  if( n_bins <= 0 ) error("'n_bins' value must be positive.");
+
+
+  /* use the caller's image data, with no copy,
+     and get the memory for the detection */
+  set_image_input( &image, img, type, (unsigned int) X, (unsigned int) Y,
+                   (size_t) stride );
+  ws = new_lsd_workspace( (unsigned int) X, (unsigned int) Y, scale,
+                          (unsigned int) n_bins );
+
+  /* size of the image used for the processing */
+  xsize = scaled_size( (unsigned int) X, scale );
+  ysize = scaled_size( (unsigned int) Y, scale );
+
+  /* save region data */
+  if( reg_img != NULL && reg_x != NULL && reg_y != NULL )
+    region = new_image_int_ini(xsize,ysize,0);
+
+  /* search for line segments */
+  lsd_detect( ws, &image, scale, sigma_scale, quant, ang_th, log_eps,
+              density_th, log_nt(xsize,ysize), out, region );
 
 
   /* free memory */
-  free( (void *) image );   /* only the double_image structure should be freed,
-                               the data pointer was provided to this functions
-                               and should not be destroyed.                 */
-  free_image_double(angles);
-  free_image_double(modgrad);
-  free_image_char(used);
-  free( (void *) reg );
-  free( (void *) mem_p );
+  free_lsd_workspace(ws);
 
   /* return the result */
   if( reg_img != NULL && reg_x != NULL && reg_y != NULL )
@@ -2206,6 +2549,22 @@ double * LineSegmentDetection( int * n_out,
   return return_value;
 }
 
+/*----------------------------------------------------------------------------*/
+/** LSD full interface.
+ */
+double * LineSegmentDetection( int * n_out,
+                               double * img, int X, int Y,
+                               double scale, double sigma_scale, double quant,
+                               double ang_th, double log_eps, double density_th,
+                               int n_bins,
+                               int ** reg_img, int * reg_x, int * reg_y )
+{
+  return LineSegmentDetectionTyped( n_out, (const void *) img, LSD_DOUBLE,
+                                    X, Y, X, scale, sigma_scale, quant,
+                                    ang_th, log_eps, density_th, n_bins,
+                                    reg_img, reg_x, reg_y );
+}
+
 /*----------------------------------------------------------------------------*/
 /** LSD Simple Interface with Scale and Region output.
  */
@@ -2247,4 +2606,712 @@ double * lsd(int * n_out, double * img, int X, int Y)
 
   return lsd_scale(n_out,img,X,Y,scale);
 }
+
+/*----------------------------------------------------------------------------*/
+/** LSD Simple Interface for any pixel type and row stride.
+ */
+static double * lsd_typed( int * n_out, const void * img, int type,
+                           int X, int Y, int stride )
+{
+  /* LSD parameters */
+  double scale = 0.8;       /* Scale the image by Gaussian filter to 'scale'. */
+  double sigma_scale = 0.6; /* Sigma for Gaussian filter is computed as
+                                sigma = sigma_scale/scale.                    */
+  double quant = 2.0;       /* Bound to the quantization error on the
+                                gradient norm.                                */
+  double ang_th = 22.5;     /* Gradient angle tolerance in degrees.           */
+  double log_eps = 0.0;     /* Detection threshold: -log10(NFA) > log_eps     */
+  double density_th = 0.7;  /* Minimal density of region points in rectangle. */
+  int n_bins = 1024;        /* Number of bins in pseudo-ordering of gradient
+                               modulus.                                       */
+
+  return LineSegmentDetectionTyped( n_out, img, type, X, Y, stride,
+                                    scale, sigma_scale, quant, ang_th,
+                                    log_eps, density_th, n_bins,
+                                    NULL, NULL, NULL );
+}
+
+/*----------------------------------------------------------------------------*/
+/** LSD Simple Interface for 8-bit images.
+ */
+double * lsd_uint8( int * n_out, const unsigned char * img,
+                    int X, int Y, int stride )
+{
+  return lsd_typed(n_out,(const void *) img,LSD_UINT8,X,Y,stride);
+}
+
+/*----------------------------------------------------------------------------*/
+/** LSD Simple Interface for 16-bit images.
+ */
+double * lsd_uint16( int * n_out, const unsigned short * img,
+                     int X, int Y, int stride )
+{
+  return lsd_typed(n_out,(const void *) img,LSD_UINT16,X,Y,stride);
+}
+
+/*----------------------------------------------------------------------------*/
+/** LSD Simple Interface for float images.
+ */
+double * lsd_float( int * n_out, const float * img,
+                    int X, int Y, int stride )
+{
+  return lsd_typed(n_out,(const void *) img,LSD_FLOAT,X,Y,stride);
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*------------------------- LSD with reusable memory -------------------------*/
+/*----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------*/
+/** State of a detector reused over many images.
+
+    The workspace is created for the first image and kept while the
+    next images fit in it; it is replaced by a larger one when needed.
+    'ws_x' and 'ws_y' are the input image size the workspace was
+    created for.
+ */
+struct lsd_detector_s
+{
+  double scale,sigma_scale,quant,ang_th,log_eps,density_th; /* LSD params */
+  int n_bins;              /* number of bins in gradient ordering */
+  struct lsd_workspace * ws;
+  int ws_x,ws_y;           /* input image size of the workspace */
+  ntuple_list out;         /* line segments detected in the last image */
+};
+
+/*----------------------------------------------------------------------------*/
+/** Create a detector with reusable memory.
+ */
+lsd_detector lsd_detector_new( double scale, double sigma_scale, double quant,
+                               double ang_th, double log_eps,
+                               double density_th, int n_bins )
+{
+  lsd_detector d;
+
+  /* check parameters */
+  if( scale <= 0.0 ) error("'scale' value must be positive.");
+  if( sigma_scale <= 0.0 ) error("'sigma_scale' value must be positive.");
+  if( quant < 0.0 ) error("'quant' value must be positive.");
+  if( ang_th <= 0.0 || ang_th >= 180.0 )
+    error("'ang_th' value must be in the range (0,180).");
+  if( density_th < 0.0 || density_th > 1.0 )
+    error("'density_th' value must be in the range [0,1].");
+  if( n_bins <= 0 ) error("'n_bins' value must be positive.");
+
+  /* get memory; the workspace is created with the first image */
+  d = (lsd_detector) malloc( sizeof(struct lsd_detector_s) );
+  if( d == NULL ) error("not enough memory.");
+  d->scale = scale;
+  d->sigma_scale = sigma_scale;
+  d->quant = quant;
+  d->ang_th = ang_th;
+  d->log_eps = log_eps;
+  d->density_th = density_th;
+  d->n_bins = n_bins;
+  d->ws = NULL;
+  d->ws_x = d->ws_y = 0;
+  d->out = new_ntuple_list(7);
+
+  return d;
+}
+
+/*----------------------------------------------------------------------------*/
+/** Free a detector with reusable memory.
+ */
+void lsd_detector_free(lsd_detector d)
+{
+  if( d == NULL ) error("lsd_detector_free: invalid detector.");
+  if( d->ws != NULL ) free_lsd_workspace(d->ws);
+  free_ntuple_list(d->out);
+  free( (void *) d );
+}
+
+/*----------------------------------------------------------------------------*/
+/** Detect the line segments of one image with a reusable detector.
+ */
+double * lsd_detector_run( lsd_detector d, int * n_out,
+                           const void * img, int type,
+                           int X, int Y, int stride )
+{
+  struct image_input_s image;
+  double * return_value;
+  unsigned int xsize,ysize;
+
+  /* check parameters */
+  if( d == NULL ) error("lsd_detector_run: invalid detector.");
+  if( n_out == NULL ) error("lsd_detector_run: invalid pointer 'n_out'.");
+  if( img == NULL || X <= 0 || Y <= 0 ) error("invalid image input.");
+  if( stride < X ) error("'stride' value must be at least X.");
+
+  /* use the caller's image data, with no copy */
+  set_image_input( &image, img, type, (unsigned int) X, (unsigned int) Y,
+                   (size_t) stride );
+
+  /* get a larger workspace if the image does not fit in the current one */
+  if( X > d->ws_x || Y > d->ws_y )
+    {
+      if( d->ws != NULL ) free_lsd_workspace(d->ws);
+      if( X > d->ws_x ) d->ws_x = X;
+      if( Y > d->ws_y ) d->ws_y = Y;
+      d->ws = new_lsd_workspace( (unsigned int) d->ws_x,
+                                 (unsigned int) d->ws_y, d->scale,
+                                 (unsigned int) d->n_bins );
+    }
+
+  /* size of the image used for the processing */
+  xsize = scaled_size( (unsigned int) X, d->scale );
+  ysize = scaled_size( (unsigned int) Y, d->scale );
+
+  /* search for line segments */
+  d->out->size = 0;
+  lsd_detect( d->ws, &image, d->scale, d->sigma_scale, d->quant, d->ang_th,
+              d->log_eps, d->density_th, log_nt(xsize,ysize), d->out, NULL );
+
+  /* return a copy of the line segments */
+  if( d->out->size > (unsigned int) INT_MAX )
+    error("too many detections to fit in an INT.");
+  *n_out = (int) d->out->size;
+  return_value = (double *) malloc( ( d->out->size > 0 ? d->out->size : 1 )
+                                    * 7 * sizeof(double) );
+  if( return_value == NULL ) error("not enough memory.");
+  memcpy( (void *) return_value, (void *) d->out->values,
+          d->out->size * 7 * sizeof(double) );
+
+  return return_value;
+}
+
+/*----------------------------------------------------------------------------*/
+/*---------------------------- LSD on video streams --------------------------*/
+/*----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------*/
+/** State of the detector over a sequence of frames.
+
+    The frame is divided in square tiles of side 'tile'. 'ref' keeps,
+    for each tile, the frame values that were used for its last
+    detection, and 'segs' the line segments currently valid for the
+    whole frame. The changed tiles are grouped in regions, rectangles
+    of tiles stored in 'box' as four values (first and last tile
+    column, first and last tile row); 'label' and 'stack' are used to
+    find them. The workspace and the lists are allocated once and
+    reused for every frame.
+ */
+struct lsd_stream_s
+{
+  int X,Y;                 /* frame size */
+  double scale,sigma_scale,quant,ang_th,log_eps,density_th; /* LSD params */
+  int tile;                /* side of the tiles, in pixels */
+  double diff_th;          /* threshold on the mean absolute difference */
+  int tiles_x,tiles_y;     /* number of tiles in each axis */
+  unsigned char * changed; /* tiles to be detected again in this frame */
+  double * ref;            /* frame values of the last detection */
+  double * row;            /* one frame row converted to doubles */
+  double * diff;           /* sum of absolute differences, one tile row */
+  unsigned char * tested;  /* tiles of a tile row covered by the mask */
+  unsigned char * label;   /* tiles already put in a region */
+  int * stack;             /* tiles to visit while grouping the tiles */
+  int * box;               /* regions to detect again, 4 values each */
+  double logNT;            /* log number of tests of the full frame */
+  int n_frames;            /* number of frames processed */
+  struct lsd_workspace * ws;
+  ntuple_list segs;        /* line segments valid for the current frame */
+  ntuple_list new_segs;    /* line segments detected in the current frame */
+  ntuple_list roi_segs;    /* line segments detected in one region */
+};
+
+/*----------------------------------------------------------------------------*/
+/** Does the line segment 'seg' (a 7-tuple) touch a changed tile?
+ */
+static int segment_in_changed_tile(lsd_stream s, double * seg)
+{
+  double hw = seg[4] / 2.0;
+  int tx0,tx1,ty0,ty1,tx,ty;
+
+  /* tiles covered by the bounding box of the segment and its width */
+  tx0 = (int) floor( ( (seg[0] < seg[2] ? seg[0] : seg[2]) - hw ) / s->tile );
+  tx1 = (int) floor( ( (seg[0] > seg[2] ? seg[0] : seg[2]) + hw ) / s->tile );
+  ty0 = (int) floor( ( (seg[1] < seg[3] ? seg[1] : seg[3]) - hw ) / s->tile );
+  ty1 = (int) floor( ( (seg[1] > seg[3] ? seg[1] : seg[3]) + hw ) / s->tile );
+  if( tx0 < 0 ) tx0 = 0;
+  if( ty0 < 0 ) ty0 = 0;
+  if( tx1 >= s->tiles_x ) tx1 = s->tiles_x - 1;
+  if( ty1 >= s->tiles_y ) ty1 = s->tiles_y - 1;
+
+  for(ty=ty0; ty<=ty1; ty++)
+    for(tx=tx0; tx<=tx1; tx++)
+      if( s->changed[ tx + ty * s->tiles_x ] ) return TRUE;
+  return FALSE;
+}
+
+/*----------------------------------------------------------------------------*/
+/** Find the tiles of 'frame' that changed since their last detection.
+
+    The frame is read one row at a time, so any pixel type is compared
+    with the double values of 'ref'.
+
+    @return            The number of changed tiles.
+ */
+static int find_changed_tiles( lsd_stream s, image_input frame,
+                               const unsigned char * mask )
+{
+  const double * row;
+  int tx,ty,x,y,x0,y0,xe,ye;
+  int n_changed = 0;
+
+  for(ty=0; ty<s->tiles_y; ty++)
+    {
+      y0 = ty * s->tile;
+      ye = y0 + s->tile < s->Y ? y0 + s->tile : s->Y;
+
+      /* sum of absolute differences of each tile of the tile row */
+      for(tx=0; tx<s->tiles_x; tx++)
+        {
+          s->diff[tx] = 0.0;
+          s->tested[tx] = mask == NULL;
+        }
+      if( s->n_frames > 0 )
+        for(y=y0; y<ye; y++)
+          {
+            row = input_row(frame,(unsigned int) y,s->row);
+            for(tx=0; tx<s->tiles_x; tx++)
+              {
+                x0 = tx * s->tile;
+                xe = x0 + s->tile < s->X ? x0 + s->tile : s->X;
+                for(x=x0; x<xe; x++)
+                  {
+                    if( mask != NULL && mask[ x + y * s->X ] )
+                      s->tested[tx] = TRUE;
+                    s->diff[tx] += fabs( row[x] - s->ref[ x + y * s->X ] );
+                  }
+              }
+          }
+
+      for(tx=0; tx<s->tiles_x; tx++)
+        {
+          x0 = tx * s->tile;
+          xe = x0 + s->tile < s->X ? x0 + s->tile : s->X;
+          if( s->n_frames == 0 )
+            s->changed[ tx + ty * s->tiles_x ] = TRUE;
+          else
+            s->changed[ tx + ty * s->tiles_x ] = s->tested[tx] &&
+              s->diff[tx] > s->diff_th * (double) ( (xe-x0) * (ye-y0) );
+          if( s->changed[ tx + ty * s->tiles_x ] ) ++n_changed;
+        }
+    }
+
+  return n_changed;
+}
+
+/*----------------------------------------------------------------------------*/
+/** Do the regions 'a' and 'b' (4 values each, in tiles) overlap?
+ */
+static int boxes_overlap(int * a, int * b)
+{
+  return a[0] <= b[1] && b[0] <= a[1] && a[2] <= b[3] && b[2] <= a[3];
+}
+
+/*----------------------------------------------------------------------------*/
+/** Merge region '*i' of the 'n' regions in 'box' with the regions it
+    overlaps, until it overlaps none.
+
+    A merged region is replaced by the last one, so '*i' is updated if
+    region '*i' was the last one. '*before' is set to TRUE if a region
+    with a smaller index was merged.
+
+    @return            The new number of regions.
+ */
+static int merge_box(int * box, int n, int * i, int * before)
+{
+  int j,k,merged;
+
+  do
+    {
+      merged = FALSE;
+      for(j=0; j<n; j++)
+        if( j != *i && boxes_overlap(box+4*j,box+4*(*i)) )
+          {
+            if( box[4*j+0] < box[4*(*i)+0] ) box[4*(*i)+0] = box[4*j+0];
+            if( box[4*j+1] > box[4*(*i)+1] ) box[4*(*i)+1] = box[4*j+1];
+            if( box[4*j+2] < box[4*(*i)+2] ) box[4*(*i)+2] = box[4*j+2];
+            if( box[4*j+3] > box[4*(*i)+3] ) box[4*(*i)+3] = box[4*j+3];
+            if( j < *i ) *before = TRUE;
+            --n;
+            for(k=0; k<4; k++) box[4*j+k] = box[4*n+k];
+            if( *i == n ) *i = j;
+            merged = TRUE;
+            break;
+          }
+    }
+  while( merged );
+
+  return n;
+}
+
+/*----------------------------------------------------------------------------*/
+/** Group the changed tiles in regions to be detected again.
+
+    Each connected component of changed tiles (8-connectivity) gives
+    the rectangle of tiles that covers it, with a margin of one tile so
+    that the line segments crossing the border of a changed tile are
+    found complete. Overlapping rectangles are merged, so the regions
+    are disjoint: a line segment is detected in a single region.
+
+    @return            The number of regions, stored in s->box.
+ */
+static int changed_regions(lsd_stream s)
+{
+  int tx,ty,t,u,n_stack,dx,dy,x,y,before;
+  int n = 0;
+  int * b;
+
+  for(t=0; t<s->tiles_x*s->tiles_y; t++) s->label[t] = FALSE;
+
+  for(t=0; t<s->tiles_x*s->tiles_y; t++)
+    if( s->changed[t] && !s->label[t] )
+      {
+        /* new connected component, grown from tile t */
+        b = s->box + 4 * n;
+        b[0] = b[1] = t % s->tiles_x;
+        b[2] = b[3] = t / s->tiles_x;
+        s->label[t] = TRUE;
+        s->stack[0] = t;
+        n_stack = 1;
+        while( n_stack > 0 )
+          {
+            u = s->stack[--n_stack];
+            tx = u % s->tiles_x;
+            ty = u / s->tiles_x;
+            if( tx < b[0] ) b[0] = tx;
+            if( tx > b[1] ) b[1] = tx;
+            if( ty < b[2] ) b[2] = ty;
+            if( ty > b[3] ) b[3] = ty;
+            for(dy=-1; dy<=1; dy++)
+              for(dx=-1; dx<=1; dx++)
+                {
+                  x = tx + dx;
+                  y = ty + dy;
+                  if( x < 0 || y < 0 || x >= s->tiles_x || y >= s->tiles_y )
+                    continue;
+                  if( s->changed[ x + y * s->tiles_x ] &&
+                      !s->label[ x + y * s->tiles_x ] )
+                    {
+                      s->label[ x + y * s->tiles_x ] = TRUE;
+                      s->stack[n_stack++] = x + y * s->tiles_x;
+                    }
+                }
+          }
+
+        /* margin of one tile */
+        if( b[0] > 0 ) --b[0];
+        if( b[1] < s->tiles_x - 1 ) ++b[1];
+        if( b[2] > 0 ) --b[2];
+        if( b[3] < s->tiles_y - 1 ) ++b[3];
+        ++n;
+      }
+
+  /* merge the overlapping regions */
+  do
+    {
+      before = FALSE;
+      for(t=0; t<n; t++) n = merge_box(s->box,n,&t,&before);
+    }
+  while( before );
+
+  return n;
+}
+
+/*----------------------------------------------------------------------------*/
+/** Detect the line segments of region 'b' (4 values, in tiles) of
+    'frame', and keep in s->roi_segs the ones touching a changed tile,
+    in frame coordinates.
+
+    Such a line segment may continue outside of the region, where it
+    would be cut. The region is then extended by one tile on each side
+    that a kept line segment comes close to, unless it is a border of
+    the frame.
+
+    @return            TRUE if the region was extended and must be
+                       detected again, FALSE otherwise.
+ */
+static int detect_region(lsd_stream s, image_input frame, int * b)
+{
+  struct image_input_s roi_image;
+  const char * data;
+  double * seg;
+  double hw,border;
+  int x0,y0,xe,ye,ext[4],k;
+  unsigned int i,n;
+
+  /* region in pixels */
+  x0 = b[0] * s->tile;
+  y0 = b[2] * s->tile;
+  xe = (b[1] + 1) * s->tile; if( xe > s->X ) xe = s->X;
+  ye = (b[3] + 1) * s->tile; if( ye > s->Y ) ye = s->Y;
+
+  /* view of the region inside the frame, with no copy */
+  data = (const char *) frame->data
+         + ( (size_t) x0 + (size_t) y0 * frame->stride )
+           * ( frame->type == LSD_DOUBLE ? sizeof(double) :
+               frame->type == LSD_FLOAT ? sizeof(float) :
+               frame->type == LSD_UINT16 ? sizeof(unsigned short) :
+                                           sizeof(unsigned char) );
+  set_image_input( &roi_image, (const void *) data, frame->type,
+                   (unsigned int) (xe - x0), (unsigned int) (ye - y0),
+                   frame->stride );
+
+  /* detect line segments in the region */
+  s->roi_segs->size = 0;
+  lsd_detect( s->ws, &roi_image, s->scale, s->sigma_scale, s->quant,
+              s->ang_th, s->log_eps, s->density_th, s->logNT,
+              s->roi_segs, NULL );
+
+  /* keep the new line segments that touch a changed tile; the others
+     are in unchanged tiles, where the previous ones are kept. A kept
+     line segment closer than two pixels of the analysis scale to the
+     border of the region may have been cut by it. */
+  border = 2.0 / s->scale;
+  ext[0] = ext[1] = ext[2] = ext[3] = FALSE;
+  for(i=0,n=0; i<s->roi_segs->size; i++)
+    {
+      seg = s->roi_segs->values + i * s->roi_segs->dim;
+      seg[0] += (double) x0; seg[1] += (double) y0;
+      seg[2] += (double) x0; seg[3] += (double) y0;
+      if( !segment_in_changed_tile(s,seg) ) continue;
+
+      hw = seg[4] / 2.0;
+      if( x0 > 0 && (seg[0] < seg[2] ? seg[0] : seg[2]) - hw < x0 + border )
+        ext[0] = TRUE;
+      if( xe < s->X && (seg[0] > seg[2] ? seg[0] : seg[2]) + hw > xe - border )
+        ext[1] = TRUE;
+      if( y0 > 0 && (seg[1] < seg[3] ? seg[1] : seg[3]) - hw < y0 + border )
+        ext[2] = TRUE;
+      if( ye < s->Y && (seg[1] > seg[3] ? seg[1] : seg[3]) + hw > ye - border )
+        ext[3] = TRUE;
+
+      if( n != i )
+        memmove( (void *) (s->roi_segs->values + n * s->roi_segs->dim),
+                 (void *) seg, s->roi_segs->dim * sizeof(double) );
+      ++n;
+    }
+  s->roi_segs->size = n;
+
+  /* extend the region */
+  if( ext[0] ) --b[0];
+  if( ext[1] ) ++b[1];
+  if( ext[2] ) --b[2];
+  if( ext[3] ) ++b[3];
+  for(k=0; k<4; k++) if( ext[k] ) return TRUE;
+  return FALSE;
+}
+/*----------------------------------------------------------------------------*/
+/** Create an LSD stream.
+ */
+lsd_stream lsd_stream_new( int X, int Y,
+                           double scale, double sigma_scale, double quant,
+                           double ang_th, double log_eps, double density_th,
+                           int n_bins, int tile, double diff_th )
+{
+  lsd_stream s;
+
+  /* check parameters */
+  if( X <= 0 || Y <= 0 ) error("lsd_stream_new: invalid frame size.");
+  if( scale <= 0.0 ) error("'scale' value must be positive.");
+  if( sigma_scale <= 0.0 ) error("'sigma_scale' value must be positive.");
+  if( quant < 0.0 ) error("'quant' value must be positive.");
+  if( ang_th <= 0.0 || ang_th >= 180.0 )
+    error("'ang_th' value must be in the range (0,180).");
+  if( density_th < 0.0 || density_th > 1.0 )
+    error("'density_th' value must be in the range [0,1].");
+  if( n_bins <= 0 ) error("'n_bins' value must be positive.");
+  if( tile <= 0 ) error("'tile' value must be positive.");
+  if( diff_th < 0.0 ) error("'diff_th' value must be positive.");
+
+  /* get memory */
+  s = (lsd_stream) malloc( sizeof(struct lsd_stream_s) );
+  if( s == NULL ) error("not enough memory.");
+  s->X = X;
+  s->Y = Y;
+  s->scale = scale;
+  s->sigma_scale = sigma_scale;
+  s->quant = quant;
+  s->ang_th = ang_th;
+  s->log_eps = log_eps;
+  s->density_th = density_th;
+  s->tile = tile;
+  s->diff_th = diff_th;
+  s->tiles_x = (X + tile - 1) / tile;
+  s->tiles_y = (Y + tile - 1) / tile;
+  s->changed = (unsigned char *) calloc( (size_t) (s->tiles_x * s->tiles_y),
+                                         sizeof(unsigned char) );
+  s->ref = (double *) calloc( (size_t) X * (size_t) Y, sizeof(double) );
+  s->row = (double *) calloc( (size_t) X, sizeof(double) );
+  s->diff = (double *) calloc( (size_t) s->tiles_x, sizeof(double) );
+  s->tested = (unsigned char *) calloc( (size_t) s->tiles_x,
+                                        sizeof(unsigned char) );
+  s->label = (unsigned char *) calloc( (size_t) (s->tiles_x * s->tiles_y),
+                                       sizeof(unsigned char) );
+  s->stack = (int *) calloc( (size_t) (s->tiles_x * s->tiles_y),
+                             sizeof(int) );
+  s->box = (int *) calloc( 4 * (size_t) (s->tiles_x * s->tiles_y),
+                           sizeof(int) );
+  if( s->changed == NULL || s->ref == NULL || s->row == NULL ||
+      s->diff == NULL || s->tested == NULL || s->label == NULL ||
+      s->stack == NULL || s->box == NULL )
+    error("not enough memory.");
+  s->ws = new_lsd_workspace( (unsigned int) X, (unsigned int) Y, scale,
+                             (unsigned int) n_bins );
+  s->segs = new_ntuple_list(7);
+  s->new_segs = new_ntuple_list(7);
+  s->roi_segs = new_ntuple_list(7);
+  s->n_frames = 0;
+
+  /* the NFA is always computed for the full frame, so that a segment
+     gets the same significance wherever it is detected again */
+  s->logNT = log_nt( scaled_size( (unsigned int) X, scale ),
+                     scaled_size( (unsigned int) Y, scale ) );
+
+  return s;
+}
+
+/*----------------------------------------------------------------------------*/
+/** Free an LSD stream.
+ */
+void lsd_stream_free(lsd_stream s)
+{
+  if( s == NULL ) error("lsd_stream_free: invalid stream.");
+  free( (void *) s->changed );
+  free( (void *) s->ref );
+  free( (void *) s->row );
+  free( (void *) s->diff );
+  free( (void *) s->tested );
+  free( (void *) s->label );
+  free( (void *) s->stack );
+  free( (void *) s->box );
+  free_lsd_workspace(s->ws);
+  free_ntuple_list(s->segs);
+  free_ntuple_list(s->new_segs);
+  free_ntuple_list(s->roi_segs);
+  free( (void *) s );
+}
+
+/*----------------------------------------------------------------------------*/
+/** LSD on the next frame of a stream, for any pixel type and row stride.
+ */
+double * lsd_stream_run( lsd_stream s, int * n_out,
+                         const void * img, int type, int stride,
+                         const unsigned char * mask )
+{
+  struct image_input_s frame;
+  const double * row;
+  double * return_value;
+  double * seg;
+  int tx,ty,x0,y0,y,ye,n,b,n_box,before;
+  unsigned int i,k;
+
+  /* check parameters */
+  if( s == NULL ) error("lsd_stream_run: invalid stream.");
+  if( img == NULL ) error("invalid image input.");
+  if( n_out == NULL ) error("lsd_stream_run: invalid pointer 'n_out'.");
+  if( stride < s->X ) error("'stride' value must be at least X.");
+
+  /* use the caller's frame data, with no copy */
+  set_image_input( &frame, img, type, (unsigned int) s->X,
+                   (unsigned int) s->Y, (size_t) stride );
+
+  /* find the tiles that changed since their last detection */
+  if( find_changed_tiles(s,&frame,mask) > 0 )
+    {
+      /* remove the line segments touching the changed tiles */
+      for(i=0,k=0; i<s->segs->size; i++)
+        {
+          seg = s->segs->values + i * s->segs->dim;
+          if( segment_in_changed_tile(s,seg) ) continue;
+          if( k != i ) memmove( (void *) (s->segs->values + k * s->segs->dim),
+                                (void *) seg, s->segs->dim * sizeof(double) );
+          ++k;
+        }
+      s->segs->size = k;
+
+      /* detect each region of changed tiles again. When a region is
+         extended, it is merged with the regions it now overlaps; if one
+         of them was already detected, all the regions are detected
+         again, so that no line segment is found twice. */
+      n_box = changed_regions(s);
+      s->new_segs->size = 0;
+      for(b=0; b<n_box; )
+        {
+          if( detect_region(s,&frame,s->box+4*b) )
+            {
+              before = FALSE;
+              n_box = merge_box(s->box,n_box,&b,&before);
+              if( before )
+                {
+                  s->new_segs->size = 0;
+                  b = 0;
+                }
+              continue;
+            }
+          for(i=0; i<s->roi_segs->size; i++)
+            {
+              seg = s->roi_segs->values + i * s->roi_segs->dim;
+              add_7tuple( s->new_segs, seg[0], seg[1], seg[2], seg[3],
+                                       seg[4], seg[5], seg[6] );
+            }
+          ++b;
+        }
+      for(i=0; i<s->new_segs->size; i++)
+        {
+          seg = s->new_segs->values + i * s->new_segs->dim;
+          add_7tuple( s->segs, seg[0], seg[1], seg[2], seg[3],
+                               seg[4], seg[5], seg[6] );
+        }
+
+      /* the changed tiles are now up to date */
+      for(ty=0; ty<s->tiles_y; ty++)
+        {
+          y0 = ty * s->tile;
+          ye = y0 + s->tile < s->Y ? y0 + s->tile : s->Y;
+          for(tx=0; tx<s->tiles_x; tx++)
+            if( s->changed[ tx + ty * s->tiles_x ] ) break;
+          if( tx == s->tiles_x ) continue;  /* no changed tile in the row */
+          for(y=y0; y<ye; y++)
+            {
+              row = input_row(&frame,(unsigned int) y,s->row);
+              for(tx=0; tx<s->tiles_x; tx++)
+                if( s->changed[ tx + ty * s->tiles_x ] )
+                  {
+                    x0 = tx * s->tile;
+                    n = (x0 + s->tile < s->X ? s->tile : s->X - x0);
+                    memcpy( (void *) (s->ref + x0 + y * s->X),
+                            (const void *) (row + x0),
+                            (size_t) n * sizeof(double) );
+                  }
+            }
+        }
+    }
+  ++(s->n_frames);
+
+  /* return a copy of the current line segments */
+  if( s->segs->size > (unsigned int) INT_MAX )
+    error("too many detections to fit in an INT.");
+  *n_out = (int) (s->segs->size);
+  return_value = (double *) malloc( ( s->segs->size > 0 ? s->segs->size : 1 )
+                                    * s->segs->dim * sizeof(double) );
+  if( return_value == NULL ) error("not enough memory.");
+  memcpy( (void *) return_value, (void *) s->segs->values,
+          s->segs->size * s->segs->dim * sizeof(double) );
+
+  return return_value;
+}
+
+/*----------------------------------------------------------------------------*/
+/** LSD on the next frame of a stream of double images.
+ */
+double * lsd_stream_detect( lsd_stream s, int * n_out, double * img,
+                            unsigned char * mask )
+{
+  return lsd_stream_run( s, n_out, (const void *) img, LSD_DOUBLE,
+                         s != NULL ? s->X : 0, mask );
+}
 /*----------------------------------------------------------------------------*/
@@ -276,5 +276,219 @@ double * lsd_scale(int * n_out, double * img, int X, int Y, double scale);
  */
 double * lsd(int * n_out, double * img, int X, int Y);
 
+/*----------------------------------------------------------------------------*/
+/** Pixel types accepted by the typed interfaces.
+ */
+#define LSD_DOUBLE 0  /* double         */
+#define LSD_FLOAT  1  /* float          */
+#define LSD_UINT8  2  /* unsigned char  */
+#define LSD_UINT16 3  /* unsigned short */
+
+/*----------------------------------------------------------------------------*/
+/** LSD full interface for any pixel type and row stride.
+
+    The image data is read in place, with no conversion to a double image;
+    rows are converted one at a time when needed. The result is the same
+    as that of LineSegmentDetection() on the image converted to doubles.
+
+    A region of interest of a larger image can be processed without a copy
+    by passing a pointer to its first pixel, its size as X x Y and the row
+    length of the larger image as 'stride'. The coordinates of the line
+    segments are then relative to the region of interest.
+
+    @param img         Pointer to input image data. The pixel at coordinates
+                       (x,y) is obtained by img[x+y*stride], with the type
+                       given by 'type'.
+
+    @param type        Pixel type: LSD_DOUBLE, LSD_FLOAT, LSD_UINT8
+                       or LSD_UINT16.
+
+    @param stride      Number of pixels between the starts of two consecutive
+                       rows. It must be at least X; use X for a packed image.
+
+    The other parameters and the return value are as in
+    LineSegmentDetection().
+ */
+double * LineSegmentDetectionTyped( int * n_out,
+                                    const void * img, int type,
+                                    int X, int Y, int stride,
+                                    double scale, double sigma_scale,
+                                    double quant, double ang_th,
+                                    double log_eps, double density_th,
+                                    int n_bins,
+                                    int ** reg_img, int * reg_x, int * reg_y );
+
+/*----------------------------------------------------------------------------*/
+/** LSD Simple Interface for 8-bit, 16-bit and float images.
+
+    Same as lsd() but the image is read in place from an array of the
+    given type, where the pixel at coordinates (x,y) is img[x+y*stride].
+    See LineSegmentDetectionTyped() for 'stride' and regions of interest.
+ */
+double * lsd_uint8( int * n_out, const unsigned char * img,
+                    int X, int Y, int stride );
+double * lsd_uint16( int * n_out, const unsigned short * img,
+                     int X, int Y, int stride );
+double * lsd_float( int * n_out, const float * img,
+                    int X, int Y, int stride );
+
+/*----------------------------------------------------------------------------*/
+/** LSD detector with memory reused over many images.
+ */
+typedef struct lsd_detector_s * lsd_detector;
+
+/*----------------------------------------------------------------------------*/
+/** LSD Reusable Interface: create a detector for a sequence of images.
+
+    The memory needed by the detector is allocated with the first image
+    and reused for the next ones; it only grows when an image does not
+    fit in it. When many images are processed, this avoids the memory
+    allocation of each call to LineSegmentDetection(). A detector must
+    be used by only one thread at a time; different threads can use
+    different detectors at the same time.
+
+    @param scale, sigma_scale, quant, ang_th, log_eps, density_th, n_bins
+                       LSD parameters, as in LineSegmentDetection().
+
+    @return            The detector, to be used with lsd_detector_run()
+                       and freed with lsd_detector_free().
+ */
+lsd_detector lsd_detector_new( double scale, double sigma_scale, double quant,
+                               double ang_th, double log_eps,
+                               double density_th, int n_bins );
+
+/*----------------------------------------------------------------------------*/
+/** LSD Reusable Interface: detect the line segments of one image.
+
+    The result is the same as LineSegmentDetectionTyped() with the
+    detector parameters and no region output.
+
+    @param d           The detector.
+
+    @param n_out, img, type, X, Y, stride
+                       As in LineSegmentDetectionTyped().
+
+    @return            A double array of size 7 x n_out, as returned by
+                       LineSegmentDetection(). The memory belongs to the
+                       caller, that should free it.
+ */
+double * lsd_detector_run( lsd_detector d, int * n_out,
+                           const void * img, int type,
+                           int X, int Y, int stride );
+
+/*----------------------------------------------------------------------------*/
+/** LSD Reusable Interface: free a detector and all its memory.
+ */
+void lsd_detector_free(lsd_detector d);
+
+/*----------------------------------------------------------------------------*/
+/** LSD state over a sequence of frames of the same size.
+ */
+typedef struct lsd_stream_s * lsd_stream;
+
+/*----------------------------------------------------------------------------*/
+/** LSD Stream Interface: create the detector state for a video stream.
+
+    The memory needed by the detector is allocated once, for frames of
+    size X x Y, and reused by each call to lsd_stream_run() or
+    lsd_stream_detect(). The frame is divided in square tiles; on each
+    frame only the tiles that changed since their last detection are
+    processed again, and the line segments found in the other tiles are
+    kept. The changed tiles are grouped in connected regions, each one
+    detected separately with a margin of one tile. A region is extended
+    while a line segment found in it reaches its border, so that the
+    line segments crossing a changed tile are found complete.
+
+    @param X           X size of the frames: the number of columns.
+
+    @param Y           Y size of the frames: the number of rows.
+
+    @param scale, sigma_scale, quant, ang_th, log_eps, density_th, n_bins
+                       LSD parameters, as in LineSegmentDetection().
+                       The NFA of the detections is computed for the
+                       full frame size, whatever the region processed.
+
+    @param tile        Side of the tiles, in pixels.
+                       Suggested value: 64
+
+    @param diff_th     A tile is detected again when the mean absolute
+                       difference between its pixels and the values used
+                       for its last detection is larger than 'diff_th'.
+                       Suggested value: 2.0
+
+    @return            The detector state, to be freed with
+                       lsd_stream_free().
+ */
+lsd_stream lsd_stream_new( int X, int Y,
+                           double scale, double sigma_scale, double quant,
+                           double ang_th, double log_eps, double density_th,
+                           int n_bins, int tile, double diff_th );
+
+/*----------------------------------------------------------------------------*/
+/** LSD Stream Interface: line segments of the next frame, for any pixel
+    type and row stride.
+
+    @param s           Detector state created by lsd_stream_new().
+
+    @param n_out       Pointer to an int where LSD will store the number of
+                       line segments detected.
+
+    @param img         Pointer to the frame data, read in place. The pixel
+                       at coordinates (x,y) is obtained by img[x+y*stride],
+                       with the type given by 'type'.
+
+    @param type        Pixel type: LSD_DOUBLE, LSD_FLOAT, LSD_UINT8
+                       or LSD_UINT16. It may change from frame to frame.
+
+    @param stride      Number of pixels between the starts of two
+                       consecutive rows. It must be at least X.
+
+    @param mask        Optional changed-region mask, as in
+                       lsd_stream_detect(). It is always packed: the
+                       pixel (x,y) is mask[x+y*X].
+
+    @return            As in lsd_stream_detect().
+ */
+double * lsd_stream_run( lsd_stream s, int * n_out,
+                         const void * img, int type, int stride,
+                         const unsigned char * mask );
+
+/*----------------------------------------------------------------------------*/
+/** LSD Stream Interface: line segments of the next frame.
+
+    Same as lsd_stream_run() for a packed frame of doubles.
+
+    @param s           Detector state created by lsd_stream_new().
+
+    @param n_out       Pointer to an int where LSD will store the number of
+                       line segments detected.
+
+    @param img         Pointer to the frame data. It must be an array of
+                       doubles of size X x Y, and the pixel at coordinates
+                       (x,y) is obtained by img[x+y*X].
+
+    @param mask        Optional changed-region mask of size X x Y, or NULL.
+                       When given, only the tiles containing at least one
+                       non zero mask pixel are tested for changes; the
+                       others keep their line segments.
+                       The first frame is always fully processed.
+                       Suggested value: NULL
+
+    @return            A double array of size 7 x n_out with the line
+                       segments valid for the frame, in the same format
+                       as returned by LineSegmentDetection(). The memory
+                       belongs to the caller. Line segments that touch a
+                       processed tile come from the current frame, the
+                       others from the last frame where their tiles were
+                       processed.
+ */
+double * lsd_stream_detect( lsd_stream s, int * n_out, double * img,
+                            unsigned char * mask );
+
+/*----------------------------------------------------------------------------*/
+/** LSD Stream Interface: free the detector state.
+ */
+void lsd_stream_free(lsd_stream s);
+
 #endif /* !LSD_HEADER */
 /*----------------------------------------------------------------------------*/
@@ -53,18 +53,33 @@
 #opt: svgfile | S | str | | | | Output line segments into SVG file 'svgfile'.  \
 #opt: width | W | double | 1.5 | | |                                           \
       LS width used in EPS and SVG files. If <=0, use detected values.         \
+#opt: binary | B | bool | | | |                                                \
+      Write 'out' as a binary file of float values, see lsd_segs.h.            \
+#opt: batch | L | bool | | | |                                                 \
+      Batch mode: 'in' lists PGM files, one per line; 'out' is a directory.    \
+#opt: threads | T | int | 1 | 1 | | Number of worker threads in batch mode.    \
 #req: in  | | str | | | | Input image (PGM)                                    \
 #req: out | | str | | | |                                                      \
       Line Segment output (each ascii line: x1,y1,x2,y2,width,p,-log10(NFA) )  \
 "
 /*----------------------------------------------------------------------------*/
 
+/* memory-mapped input, worker threads and timing use POSIX functions */
+#define _POSIX_C_SOURCE 200112L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>
 #include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <time.h>
 #include "lsd.h"
+#include "lsd_segs.h"
 
 #ifndef FALSE
 #define FALSE 0
@@ -839,6 +854,8 @@ static int get_num(FILE * f)
 /*----------------------------------------------------------------------------*/
 /** Read a PGM file into an double image.
     If the name is "-" the file is read from standard input.
+    Binary files with a depth above 255 have two bytes per sample, most
+    significant byte first, as decoded by map_pgm_image().
  */
 static double * read_pgm_image_double(int * X, int * Y, char * name)
 {
@@ -876,8 +893,13 @@ static double * read_pgm_image_double(int * X, int * Y, char * name)
   /* read data */
   for(y=0;y<ysize;y++)
     for(x=0;x<xsize;x++)
-      image[ x + y * xsize ] = bin ? (double) getc(f)
-                                   : (double) get_num(f);
+      if( !bin ) image[ x + y * xsize ] = (double) get_num(f);
+      else if( depth < 256 ) image[ x + y * xsize ] = (double) getc(f);
+      else
+        {
+          c = getc(f);
+          image[ x + y * xsize ] = (double) ( (c << 8) | getc(f) );
+        }
 
   /* close file if needed */
   if( f != stdin && fclose(f) == EOF )
@@ -944,6 +966,197 @@ static void write_pgm_image_int(int * image, int xsize, int ysize, char * name)
 }
 
 
+/*----------------------------------------------------------------------------*/
+/** PGM image read from a memory-mapped file.
+
+    For binary PGM files of 8 bits 'data' points directly into the
+    mapped file, so the pixels are used with no copy. Otherwise the
+    pixels are converted into 'buffer', 16 bits values to unsigned
+    short and ASCII values to double; the buffer is kept from one
+    image to the next and only grows when needed.
+ */
+struct pgm_image
+{
+  unsigned char * map;  /* mapped file */
+  size_t map_size;      /* size of the mapped file, in bytes */
+  const void * data;    /* pixel values, the pixel (x,y) is data[x+y*X] */
+  int type;             /* LSD pixel type of 'data' */
+  int X,Y;              /* image size */
+  void * buffer;        /* conversion buffer */
+  size_t buffer_size;   /* size of 'buffer', in bytes */
+};
+
+/*----------------------------------------------------------------------------*/
+/** Skip white characters and comments in a memory-mapped PGM file.
+ */
+static unsigned char * map_skip_whites_and_comments( unsigned char * p,
+                                                     unsigned char * end )
+{
+  while( p < end && ( isspace(*p) || *p == '#' ) )
+    {
+      if( *p == '#' ) /* skip comments */
+        while( p < end && *p != '\n' && *p != '\r' ) ++p;
+      else ++p;       /* skip spaces */
+    }
+  return p;
+}
+
+/*----------------------------------------------------------------------------*/
+/** Read a ASCII number from a memory-mapped PGM file.
+    Returns -1 when there is no number.
+ */
+static int map_get_num(unsigned char ** p, unsigned char * end)
+{
+  int num;
+
+  while( *p < end && isspace(**p) ) ++(*p);
+  if( *p >= end || !isdigit(**p) ) return -1;
+  for( num = 0; *p < end && isdigit(**p); ++(*p) ) num = 10 * num + **p - '0';
+
+  return num;
+}
+
+/*----------------------------------------------------------------------------*/
+/** Get a conversion buffer of at least 'size' bytes in a pgm_image.
+    Returns NULL when there is not enough memory.
+ */
+static void * pgm_image_buffer(struct pgm_image * im, size_t size)
+{
+  if( size > im->buffer_size )
+    {
+      free( im->buffer );
+      im->buffer = malloc(size);
+      im->buffer_size = im->buffer == NULL ? 0 : size;
+    }
+  return im->buffer;
+}
+
+/*----------------------------------------------------------------------------*/
+/** Report an error on a PGM file being mapped, and unmap it.
+    Returns FALSE, the value of map_pgm_image() on error.
+ */
+static int map_pgm_error(struct pgm_image * im, char * name, char * msg)
+{
+  fprintf(stderr,"Error: %s '%s'.\n",msg,name);
+  if( im->map != NULL ) munmap( (void *) im->map, im->map_size );
+  im->map = NULL;
+  im->data = NULL;
+  return FALSE;
+}
+
+/*----------------------------------------------------------------------------*/
+/** Map a PGM file into memory and get its pixels.
+    The file must be unmapped with unmap_pgm_image() after its use.
+
+    Returns TRUE on success. When the file cannot be read or is not a
+    valid PGM file, the error is reported on standard-error output with
+    the file name, nothing is left mapped and FALSE is returned, so that
+    a batch can go on with the next image.
+ */
+static int map_pgm_image(struct pgm_image * im, char * name)
+{
+  struct stat st;
+  unsigned char * p;
+  unsigned char * end;
+  unsigned short * data16;
+  double * data;
+  int fd,bin,depth,v;
+  size_t n,i;
+
+  /* map file */
+  im->map = NULL;
+  fd = open(name,O_RDONLY);
+  if( fd < 0 ) return map_pgm_error(im,name,"unable to open input image file");
+  if( fstat(fd,&st) != 0 || st.st_size <= 0 )
+    {
+      close(fd);
+      return map_pgm_error(im,name,"unable to read input image file");
+    }
+  im->map_size = (size_t) st.st_size;
+  p = (unsigned char *) mmap( NULL, im->map_size, PROT_READ, MAP_PRIVATE,
+                              fd, 0 );
+  close(fd); /* the mapping stays valid once the file is closed */
+  if( p == (unsigned char *) MAP_FAILED )
+    return map_pgm_error(im,name,"unable to map input image file");
+  im->map = p;
+  end = p + im->map_size;
+
+  /* read header */
+  if( end - p < 2 || *p++ != 'P' || ( *p != '2' && *p != '5' ) )
+    return map_pgm_error(im,name,"not a PGM file");
+  bin = *p++ == '5';
+  p = map_skip_whites_and_comments(p,end);
+  im->X = map_get_num(&p,end);   /* X size */
+  if(im->X<=0) return map_pgm_error(im,name,"X size <=0, invalid PGM file");
+  p = map_skip_whites_and_comments(p,end);
+  im->Y = map_get_num(&p,end);   /* Y size */
+  if(im->Y<=0) return map_pgm_error(im,name,"Y size <=0, invalid PGM file");
+  p = map_skip_whites_and_comments(p,end);
+  depth = map_get_num(&p,end);   /* depth */
+  if(depth<0) return map_pgm_error(im,name,"corrupted PGM file");
+  if(depth==0) fprintf(stderr,"Warning: depth<=0, probably invalid PGM file\n");
+  /* white before data */
+  if( p >= end || !isspace(*p++) )
+    return map_pgm_error(im,name,"corrupted PGM file");
+
+  /* get the pixels */
+  n = (size_t) im->X * (size_t) im->Y;
+  if( bin && depth < 256 )        /* 8 bits: used in place */
+    {
+      if( (size_t) (end - p) < n )
+        return map_pgm_error(im,name,"corrupted PGM file");
+      im->data = (const void *) p;
+      im->type = LSD_UINT8;
+    }
+  else if( bin )                  /* 16 bits, most significant byte first */
+    {
+      if( (size_t) (end - p) / 2 < n )
+        return map_pgm_error(im,name,"corrupted PGM file");
+      data16 = (unsigned short *) pgm_image_buffer(im,n*sizeof(unsigned short));
+      if( data16 == NULL ) return map_pgm_error(im,name,"not enough memory for");
+      for(i=0; i<n; i++, p+=2)
+        data16[i] = (unsigned short) ( (p[0] << 8) | p[1] );
+      im->data = (const void *) data16;
+      im->type = LSD_UINT16;
+    }
+  else                            /* ASCII */
+    {
+      data = (double *) pgm_image_buffer(im,n*sizeof(double));
+      if( data == NULL ) return map_pgm_error(im,name,"not enough memory for");
+      for(i=0; i<n; i++)
+        {
+          if( (v = map_get_num(&p,end)) < 0 )
+            return map_pgm_error(im,name,"corrupted PGM file");
+          data[i] = (double) v;
+        }
+      im->data = (const void *) data;
+      im->type = LSD_DOUBLE;
+    }
+
+  return TRUE;
+}
+
+/*----------------------------------------------------------------------------*/
+/** Unmap a PGM file mapped by map_pgm_image().
+    The conversion buffer is kept for the next image.
+ */
+static void unmap_pgm_image(struct pgm_image * im)
+{
+  if( munmap( (void *) im->map, im->map_size ) != 0 )
+    error("Error: unable to unmap input image file.");
+  im->map = NULL;
+  im->data = NULL;
+}
+
+/*----------------------------------------------------------------------------*/
+/** Size of the stdio buffer of the text output files.
+    A large buffer makes that the formatted line segments are written
+    in a few big blocks. It is only set on the files just opened:
+    setvbuf() must come before any other operation on a stream, which
+    does not hold for standard output.
+ */
+#define OUTPUT_BUFFER_SIZE (1<<20)
+
 /*----------------------------------------------------------------------------*/
 /*----------------------------- Write EPS File -------------------------------*/
 /*----------------------------------------------------------------------------*/
@@ -973,7 +1186,8 @@ static void write_eps( double * segs, int n, int dim,
 
   /* open file */
   if( strcmp(filename,"-") == 0 ) eps = stdout;
-  else eps = fopen(filename,"w");
+  else if( ( eps = fopen(filename,"w") ) != NULL )
+    setvbuf(eps,NULL,_IOFBF,OUTPUT_BUFFER_SIZE);
   if( eps == NULL ) error("Error: unable to open EPS output file.");
 
   /* write EPS header */
@@ -1022,7 +1236,8 @@ static void write_svg( double * segs, int n, int dim,
 
   /* open file */
   if( strcmp(filename,"-") == 0 ) svg = stdout;
-  else svg = fopen(filename,"w");
+  else if( ( svg = fopen(filename,"w") ) != NULL )
+    setvbuf(svg,NULL,_IOFBF,OUTPUT_BUFFER_SIZE);
   if( svg == NULL ) error("Error: unable to open SVG output file.");
 
   /* write SVG header */
@@ -1050,6 +1265,338 @@ static void write_svg( double * segs, int n, int dim,
 }
 
 
+/*----------------------------------------------------------------------------*/
+/*---------------------------- Write ASCII File ------------------------------*/
+/*----------------------------------------------------------------------------*/
+/** Write line segments into an ASCII file, one line segment per line.
+    If the name is "-" the file is written to standard output.
+ */
+static void write_ascii( double * segs, int n, int dim, char * filename )
+{
+  FILE * output;
+  int i,j;
+
+  /* check input */
+  if( segs == NULL || n < 0 || dim <= 0 )
+    error("Error: invalid line segment list in write_ascii.");
+
+  /* open file */
+  if( strcmp(filename,"-") == 0 ) output = stdout;
+  else if( ( output = fopen(filename,"w") ) != NULL )
+    setvbuf(output,NULL,_IOFBF,OUTPUT_BUFFER_SIZE);
+  if( output == NULL ) error("Error: unable to open ASCII output file.");
+
+  /* write line segments */
+  for(i=0;i<n;i++)
+    {
+      for(j=0;j<dim;j++)
+        fprintf(output,"%f ",segs[i*dim+j]);
+      fprintf(output,"\n");
+    }
+
+  /* close file if needed */
+  if( output != stdout && fclose(output) == EOF )
+    error("Error: unable to close file while output file.");
+}
+
+
+/*----------------------------------------------------------------------------*/
+/*-------------------------------- Batch mode --------------------------------*/
+/*----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------*/
+/** One image of the batch and its results.
+ */
+struct batch_image
+{
+  char * name;     /* input file name */
+  char * out;      /* output file name */
+  int n;           /* number of line segments detected, -1 if failed */
+  double seconds;  /* processing time, reading and writing included */
+};
+
+/*----------------------------------------------------------------------------*/
+/** State of a batch shared by the worker threads.
+    The images are taken in order by the workers; 'next' is the index of
+    the next image to be processed and is protected by 'lock'.
+ */
+struct batch
+{
+  struct arguments * arg;
+  struct batch_image * images;
+  int n_images;
+  int next;
+  pthread_mutex_t lock;
+};
+
+/*----------------------------------------------------------------------------*/
+/** Monotonic time in seconds.
+ */
+static double get_time(void)
+{
+  struct timespec t;
+
+  if( clock_gettime(CLOCK_MONOTONIC,&t) != 0 )
+    error("Error: unable to get the time.");
+  return (double) t.tv_sec + 1e-9 * (double) t.tv_nsec;
+}
+
+/*----------------------------------------------------------------------------*/
+/** Read the list of images of a batch, one file name per line.
+    Empty lines and lines starting with '#' are ignored.
+ */
+static struct batch_image * read_batch_list(char * name, int * n_images)
+{
+  FILE * f;
+  char line[FILENAME_MAX];
+  struct batch_image * images;
+  int n = 0;
+  int allocated = 16;
+  size_t len;
+
+  /* open file */
+  if( strcmp(name,"-") == 0 ) f = stdin;
+  else f = fopen(name,"r");
+  if( f == NULL ) error("Error: unable to open batch list file.");
+
+  /* get memory */
+  images = (struct batch_image *) malloc( allocated *
+                                          sizeof(struct batch_image) );
+  if( images == NULL ) error("Error: not enough memory.");
+
+  /* read file names */
+  while( fgets(line,FILENAME_MAX,f) != NULL )
+    {
+      len = strlen(line);
+      while( len > 0 && isspace( (unsigned char) line[len-1] ) )
+        line[--len] = '\0';
+      if( len == 0 || line[0] == '#' ) continue;
+
+      if( n >= allocated )
+        {
+          allocated *= 2;
+          images = (struct batch_image *) realloc( (void *) images,
+                                    allocated * sizeof(struct batch_image) );
+          if( images == NULL ) error("Error: not enough memory.");
+        }
+      images[n].name = (char *) malloc(len+1);
+      if( images[n].name == NULL ) error("Error: not enough memory.");
+      strcpy(images[n].name,line);
+      images[n].n = 0;
+      images[n].seconds = 0.0;
+      images[n].out = NULL;
+      ++n;
+    }
+
+  /* close file if needed */
+  if( ferror(f) ) error("Error: unable to read batch list file.");
+  if( f != stdin && fclose(f) == EOF )
+    error("Error: unable to close file while reading batch list file.");
+
+  *n_images = n;
+  return images;
+}
+
+/*----------------------------------------------------------------------------*/
+/** Name of the output file of an image in batch mode: the output
+    directory, the base name of the image and the extension '.txt',
+    or '.lsds' for binary files.
+ */
+static char * batch_output_name(char * dir, char * image, int binary)
+{
+  char * base = strrchr(image,'/');
+  char * name;
+
+  base = base == NULL ? image : base + 1;
+  name = (char *) malloc( strlen(dir) + strlen(base) + 7 );
+  if( name == NULL ) error("Error: not enough memory.");
+  sprintf(name,"%s/%s%s",dir,base,binary ? ".lsds" : ".txt");
+
+  return name;
+}
+
+/*----------------------------------------------------------------------------*/
+/** Order of two images of a batch by output file name, for qsort().
+ */
+static int compare_output_names(const void * a, const void * b)
+{
+  return strcmp( (*(const struct batch_image * const *) a)->out,
+                 (*(const struct batch_image * const *) b)->out );
+}
+
+/*----------------------------------------------------------------------------*/
+/** Set the output file name of each image of a batch.
+
+    Images with the same base name in different directories would be
+    written to the same output file, so the batch is rejected before
+    any processing when two output names collide; all the colliding
+    input files are reported.
+ */
+static void set_batch_output_names( struct batch_image * images, int n_images,
+                                    char * dir, int binary )
+{
+  struct batch_image ** sorted;
+  int i,collisions = 0;
+
+  for(i=0; i<n_images; i++)
+    images[i].out = batch_output_name(dir,images[i].name,binary);
+
+  /* look for equal output names, that are consecutive once sorted */
+  sorted = (struct batch_image **) malloc( ( n_images > 0 ? n_images : 1 )
+                                           * sizeof(struct batch_image *) );
+  if( sorted == NULL ) error("Error: not enough memory.");
+  for(i=0; i<n_images; i++) sorted[i] = images + i;
+  qsort( (void *) sorted, (size_t) n_images, sizeof(struct batch_image *),
+         compare_output_names );
+  for(i=1; i<n_images; i++)
+    if( strcmp(sorted[i-1]->out,sorted[i]->out) == 0 )
+      {
+        fprintf(stderr,"Error: '%s' and '%s' would both be written to '%s'.\n",
+                sorted[i-1]->name, sorted[i]->name, sorted[i]->out);
+        ++collisions;
+      }
+  free( (void *) sorted );
+
+  if( collisions > 0 )
+    error("Error: input files with the same name in batch mode.");
+}
+
+/*----------------------------------------------------------------------------*/
+/** Worker thread of the batch mode.
+
+    Each worker has its own detector and PGM conversion buffer, that are
+    reused for all the images it processes.
+ */
+static void * batch_worker(void * p)
+{
+  struct batch * b = (struct batch *) p;
+  struct arguments * arg = b->arg;
+  struct pgm_image im;
+  lsd_detector d;
+  int binary = is_assigned(arg,"binary");
+  double * segs;
+  double t;
+  int i,n;
+
+  /* per-worker memory */
+  d = lsd_detector_new( get_double(arg,"scale"),
+                        get_double(arg,"sigma_coef"),
+                        get_double(arg,"quant"),
+                        get_double(arg,"ang_th"),
+                        get_double(arg,"log_eps"),
+                        get_double(arg,"density_th"),
+                        get_int(arg,"n_bins") );
+  im.buffer = NULL;
+  im.buffer_size = 0;
+
+  for(;;)
+    {
+      /* take the next image */
+      if( pthread_mutex_lock(&b->lock) != 0 )
+        error("Error: unable to lock the batch list.");
+      i = b->next++;
+      if( pthread_mutex_unlock(&b->lock) != 0 )
+        error("Error: unable to unlock the batch list.");
+      if( i >= b->n_images ) break;
+
+      /* read, detect and write; an image that cannot be read is marked
+         as failed and the batch goes on */
+      t = get_time();
+      if( !map_pgm_image(&im,b->images[i].name) )
+        {
+          b->images[i].n = -1;
+          b->images[i].seconds = get_time() - t;
+          continue;
+        }
+      segs = lsd_detector_run(d,&n,im.data,im.type,im.X,im.Y,im.X);
+      unmap_pgm_image(&im);
+      if(binary) write_lsd_segments(segs,n,7,im.X,im.Y,b->images[i].out);
+      else write_ascii(segs,n,7,b->images[i].out);
+      b->images[i].n = n;
+      b->images[i].seconds = get_time() - t;
+
+      /* free memory */
+      free( (void *) segs );
+    }
+
+  /* free memory */
+  free( im.buffer );
+  lsd_detector_free(d);
+
+  return NULL;
+}
+
+/*----------------------------------------------------------------------------*/
+/** Batch mode: process the list of images in 'in' with a pool of worker
+    threads and write the results in the directory 'out'. The processing
+    time of each image and the total number of images per second are
+    printed to standard output.
+
+    Returns the number of images that could not be read.
+ */
+static int run_batch(struct arguments * arg)
+{
+  struct batch b;
+  pthread_t * threads;
+  int n_threads = get_int(arg,"threads");
+  double t;
+  int i,failed = 0;
+
+  /* check options */
+  if( is_assigned(arg,"reg") || is_assigned(arg,"epsfile") ||
+      is_assigned(arg,"svgfile") )
+    error("Error: options -R, -P and -S are not available in batch mode.");
+
+  /* read list */
+  b.arg = arg;
+  b.images = read_batch_list(get_str(arg,"in"),&b.n_images);
+  set_batch_output_names( b.images, b.n_images, get_str(arg,"out"),
+                          is_assigned(arg,"binary") );
+  b.next = 0;
+  if( pthread_mutex_init(&b.lock,NULL) != 0 )
+    error("Error: unable to create the batch lock.");
+  if( n_threads > b.n_images ) n_threads = b.n_images > 0 ? b.n_images : 1;
+
+  /* process the images */
+  threads = (pthread_t *) malloc( n_threads * sizeof(pthread_t) );
+  if( threads == NULL ) error("Error: not enough memory.");
+  t = get_time();
+  for(i=0; i<n_threads; i++)
+    if( pthread_create(threads+i,NULL,batch_worker,(void *) &b) != 0 )
+      error("Error: unable to create worker thread.");
+  for(i=0; i<n_threads; i++)
+    if( pthread_join(threads[i],NULL) != 0 )
+      error("Error: unable to join worker thread.");
+  t = get_time() - t;
+
+  /* report */
+  for(i=0; i<b.n_images; i++)
+    if( b.images[i].n < 0 )
+      {
+        printf("%s: failed\n",b.images[i].name);
+        ++failed;
+      }
+    else
+      printf("%s: %d line segments, %.3f s\n",
+             b.images[i].name, b.images[i].n, b.images[i].seconds);
+  printf("%d images (%d failed) in %.3f s with %d threads: %.2f images/s\n",
+         b.n_images - failed, failed, t, n_threads,
+         t > 0.0 ? ( b.n_images - failed ) / t : 0.0);
+
+  /* free memory */
+  pthread_mutex_destroy(&b.lock);
+  for(i=0; i<b.n_images; i++)
+    {
+      free( (void *) b.images[i].name );
+      free( (void *) b.images[i].out );
+    }
+  free( (void *) b.images );
+  free( (void *) threads );
+
+  return failed;
+}
+
+
 /*----------------------------------------------------------------------------*/
 /*                                    Main                                    */
 /*----------------------------------------------------------------------------*/
@@ -1058,43 +1605,65 @@ static void write_svg( double * segs, int n, int dim,
 int main(int argc, char ** argv)
 {
   struct arguments * arg = process_arguments(USE,argc,argv);
-  FILE * output;
-  double * image;
+  struct pgm_image im;
+  double * image = NULL;
   int X,Y;
   double * segs;
   int n;
   int dim = 7;
   int * region;
   int regX,regY;
-  int i,j;
 
-  /* read input file */
-  image = read_pgm_image_double(&X,&Y,get_str(arg,"in"));
+  /* batch mode */
+  if(is_assigned(arg,"batch"))
+    {
+      n = run_batch(arg);
+      free_arguments(arg);
+      return n > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
 
-  /* execute LSD */
-  segs = LineSegmentDetection( &n, image, X, Y,
-                               get_double(arg,"scale"),
-                               get_double(arg,"sigma_coef"),
-                               get_double(arg,"quant"),
-                               get_double(arg,"ang_th"),
-                               get_double(arg,"log_eps"),
-                               get_double(arg,"density_th"),
-                               get_int(arg,"n_bins"),
-                               is_assigned(arg,"reg") ? &region : NULL,
-                               &regX, &regY );
+  /* read input file: standard input is read into a double image,
+     files are memory-mapped and their pixels used in place */
+  if( strcmp(get_str(arg,"in"),"-") == 0 )
+    {
+      image = read_pgm_image_double(&X,&Y,get_str(arg,"in"));
+      im.data = (const void *) image;
+      im.type = LSD_DOUBLE;
+    }
+  else
+    {
+      im.buffer = NULL;
+      im.buffer_size = 0;
+      if( !map_pgm_image(&im,get_str(arg,"in")) ) exit(EXIT_FAILURE);
+      X = im.X;
+      Y = im.Y;
+    }
 
-  /* output */
-  if( strcmp(get_str(arg,"out"),"-") == 0 ) output = stdout;
-  else output = fopen(get_str(arg,"out"),"w");
-  if( output == NULL ) error("Error: unable to open ASCII output file.");
-  for(i=0;i<n;i++)
+  /* execute LSD */
+  segs = LineSegmentDetectionTyped( &n, im.data, im.type, X, Y, X,
+                                    get_double(arg,"scale"),
+                                    get_double(arg,"sigma_coef"),
+                                    get_double(arg,"quant"),
+                                    get_double(arg,"ang_th"),
+                                    get_double(arg,"log_eps"),
+                                    get_double(arg,"density_th"),
+                                    get_int(arg,"n_bins"),
+                                    is_assigned(arg,"reg") ? &region : NULL,
+                                    &regX, &regY );
+
+  /* free input */
+  if( image != NULL ) free( (void *) image );
+  else
     {
-      for(j=0;j<dim;j++)
-        fprintf(output,"%f ",segs[i*dim+j]);
-      fprintf(output,"\n");
+      unmap_pgm_image(&im);
+      free( im.buffer );
     }
-  if( output != stdout && fclose(output) == EOF ) /* close file if needed */
-    error("Error: unable to close file while output file.");
+
+  /* output */
+  if(is_assigned(arg,"binary"))
+    write_lsd_segments(segs,n,dim,X,Y,get_str(arg,"out"));
+  else
+    write_ascii(segs,n,dim,get_str(arg,"out"));
 
   /* store region output if needed */
   if(is_assigned(arg,"reg"))
@@ -1112,7 +1681,6 @@ int main(int argc, char ** argv)
     write_svg(segs,n,dim,get_str(arg,"svgfile"),X,Y,get_double(arg,"width"));
 
   /* free memory */
-  free( (void *) image );
   free( (void *) segs );
   free_arguments(arg);
 
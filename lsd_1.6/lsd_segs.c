@@ -0,0 +1,223 @@
+/*----------------------------------------------------------------------------
+
+  LSD - Line Segment Detector on digital images
+
+  Copyright (c) 2007-2011 rafael grompone von gioi <grompone@gmail.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+  ----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------*/
+/** @file lsd_segs.c
+    Binary line segment files: writer and reader.
+    The file format is described in lsd_segs.h.
+ */
+/*----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lsd_segs.h"
+
+/*----------------------------------------------------------------------------*/
+/** Size of the header of a binary line segment file, in bytes.
+ */
+#define HEADER_SIZE 24
+
+/*----------------------------------------------------------------------------*/
+/** Number of float values converted and written with each call to fwrite.
+ */
+#define CHUNK_SIZE 8192
+
+/*----------------------------------------------------------------------------*/
+/** Fatal error, print a message to standard-error output and exit.
+ */
+static void error(char * msg)
+{
+  fprintf(stderr,"LSD Error: %s\n",msg);
+  exit(EXIT_FAILURE);
+}
+
+/*----------------------------------------------------------------------------*/
+/** Store a 32 bits unsigned integer in little-endian byte order.
+ */
+static void put_uint32(unsigned char * p, unsigned long v)
+{
+  p[0] = (unsigned char) ( v        & 0xff);
+  p[1] = (unsigned char) ((v >>  8) & 0xff);
+  p[2] = (unsigned char) ((v >> 16) & 0xff);
+  p[3] = (unsigned char) ((v >> 24) & 0xff);
+}
+
+/*----------------------------------------------------------------------------*/
+/** Get a 32 bits unsigned integer stored in little-endian byte order.
+ */
+static unsigned long get_uint32(unsigned char * p)
+{
+  return   (unsigned long) p[0]         | ((unsigned long) p[1] <<  8)
+        | ((unsigned long) p[2] << 16)  | ((unsigned long) p[3] << 24);
+}
+
+/*----------------------------------------------------------------------------*/
+/** Store a float in little-endian byte order.
+    The float is assumed to be a 32 bits IEEE 754 number, whose bits
+    are handled as a 32 bits unsigned integer of the same byte order.
+ */
+static void put_float(unsigned char * p, float f)
+{
+  unsigned int v;
+
+  memcpy( (void *) &v, (void *) &f, 4 );
+  put_uint32(p,(unsigned long) v);
+}
+
+/*----------------------------------------------------------------------------*/
+/** Get a float stored in little-endian byte order.
+ */
+static float get_float(unsigned char * p)
+{
+  unsigned int v = (unsigned int) get_uint32(p);
+  float f;
+
+  memcpy( (void *) &f, (void *) &v, 4 );
+  return f;
+}
+
+/*----------------------------------------------------------------------------*/
+/** Write line segments into a binary line segment file.
+
+    The values are converted to little-endian floats by chunks of
+    CHUNK_SIZE values, and each chunk is written with one call to fwrite.
+ */
+void write_lsd_segments( double * segs, int n, int dim, int X, int Y,
+                         char * filename )
+{
+  unsigned char header[HEADER_SIZE];
+  unsigned char * buffer;
+  FILE * f;
+  size_t total,i,k;
+
+  /* check input */
+  if( sizeof(float) != 4 || sizeof(unsigned int) != 4 )
+    error("write_lsd_segments: float and unsigned int must be 32 bits.");
+  if( segs == NULL || n < 0 || dim <= 0 )
+    error("write_lsd_segments: invalid line segment list.");
+  if( X <= 0 || Y <= 0 ) error("write_lsd_segments: invalid image size.");
+  if( filename == NULL ) error("write_lsd_segments: invalid file name.");
+
+  /* get memory */
+  buffer = (unsigned char *) malloc( 4 * CHUNK_SIZE );
+  if( buffer == NULL ) error("not enough memory.");
+
+  /* open file */
+  if( strcmp(filename,"-") == 0 ) f = stdout;
+  else f = fopen(filename,"wb");
+  if( f == NULL ) error("unable to open binary line segment output file.");
+
+  /* write header */
+  memcpy( (void *) header, (void *) "LSDS", 4 );
+  put_uint32(header+4, (unsigned long) LSD_SEGS_VERSION);
+  put_uint32(header+8, (unsigned long) dim);
+  put_uint32(header+12,(unsigned long) n);
+  put_uint32(header+16,(unsigned long) X);
+  put_uint32(header+20,(unsigned long) Y);
+  if( fwrite( (void *) header, 1, HEADER_SIZE, f ) != HEADER_SIZE )
+    error("unable to write binary line segment file.");
+
+  /* write line segments */
+  total = (size_t) n * (size_t) dim;
+  for(i=0; i<total; i+=k)
+    {
+      for(k=0; k<CHUNK_SIZE && i+k<total; k++)
+        put_float(buffer + 4*k, (float) segs[i+k]);
+      if( fwrite( (void *) buffer, 4, k, f ) != k )
+        error("unable to write binary line segment file.");
+    }
+
+  /* close file if needed */
+  if( f != stdout && fclose(f) == EOF )
+    error("unable to close file while writing binary line segment file.");
+
+  /* free memory */
+  free( (void *) buffer );
+}
+
+/*----------------------------------------------------------------------------*/
+/** Read a binary line segment file.
+ */
+float * read_lsd_segments( int * n, int * dim, int * X, int * Y,
+                           char * filename )
+{
+  unsigned char header[HEADER_SIZE];
+  unsigned char * buffer;
+  unsigned long version,d,m;
+  float * segs;
+  FILE * f;
+  size_t total,i,k;
+
+  /* check input */
+  if( sizeof(float) != 4 || sizeof(unsigned int) != 4 )
+    error("read_lsd_segments: float and unsigned int must be 32 bits.");
+  if( n == NULL || dim == NULL || filename == NULL )
+    error("read_lsd_segments: invalid input.");
+
+  /* open file */
+  if( strcmp(filename,"-") == 0 ) f = stdin;
+  else f = fopen(filename,"rb");
+  if( f == NULL ) error("unable to open binary line segment file.");
+
+  /* read header */
+  if( fread( (void *) header, 1, HEADER_SIZE, f ) != HEADER_SIZE
+      || memcmp( (void *) header, (void *) "LSDS", 4 ) != 0 )
+    error("not a binary line segment file.");
+  version = get_uint32(header+4);
+  d = get_uint32(header+8);
+  m = get_uint32(header+12);
+  if( version != LSD_SEGS_VERSION )
+    error("unsupported binary line segment file version.");
+  if( d == 0 || d > 0xffffUL || m > 0x7fffffffUL / d )
+    error("corrupted binary line segment file.");
+
+  /* get memory */
+  total = (size_t) m * (size_t) d;
+  segs = (float *) malloc( (total > 0 ? total : 1) * sizeof(float) );
+  buffer = (unsigned char *) malloc( 4 * CHUNK_SIZE );
+  if( segs == NULL || buffer == NULL ) error("not enough memory.");
+
+  /* read line segments */
+  for(i=0; i<total; i+=k)
+    {
+      k = total - i < CHUNK_SIZE ? total - i : CHUNK_SIZE;
+      if( fread( (void *) buffer, 4, k, f ) != k )
+        error("truncated binary line segment file.");
+      for(k=0; k<CHUNK_SIZE && i+k<total; k++)
+        segs[i+k] = get_float(buffer + 4*k);
+    }
+
+  /* close file if needed */
+  if( f != stdin && fclose(f) == EOF )
+    error("unable to close file while reading binary line segment file.");
+
+  /* free memory */
+  free( (void *) buffer );
+
+  /* return line segments */
+  *n = (int) m;
+  *dim = (int) d;
+  if( X != NULL ) *X = (int) get_uint32(header+16);
+  if( Y != NULL ) *Y = (int) get_uint32(header+20);
+  return segs;
+}
+/*----------------------------------------------------------------------------*/
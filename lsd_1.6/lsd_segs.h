@@ -0,0 +1,92 @@
+/*----------------------------------------------------------------------------
+
+  LSD - Line Segment Detector on digital images
+
+  Copyright (c) 2007-2011 rafael grompone von gioi <grompone@gmail.com>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+  ----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------*/
+/** @file lsd_segs.h
+    Binary line segment files: writer and reader.
+
+    A binary line segment file is a 24 bytes header followed by the
+    line segments. The header is made of the 4 characters "LSDS" and
+    five unsigned 32 bits integers: the format version (1), the number
+    of values per line segment (7), the number of line segments n, and
+    the X and Y size of the image where they were detected. Then follow
+    n records of 7 float values, each stored as a 32 bits IEEE 754 float:
+    x1,y1,x2,y2,width,p,-log10(NFA), as in the ASCII output of LSD.
+    All the numbers are stored in little-endian byte order, whatever
+    the byte order of the machine.
+ */
+/*----------------------------------------------------------------------------*/
+#ifndef LSD_SEGS_HEADER
+#define LSD_SEGS_HEADER
+
+/*----------------------------------------------------------------------------*/
+/** Version of the binary line segment file format.
+ */
+#define LSD_SEGS_VERSION 1
+
+/*----------------------------------------------------------------------------*/
+/** Write line segments into a binary line segment file.
+    If the name is "-" the file is written to standard output.
+
+    @param segs        Line segments, as returned by LSD: 'dim' values
+                       per line segment.
+
+    @param n           Number of line segments.
+
+    @param dim         Number of values per line segment.
+
+    @param X           X size of the image where they were detected.
+
+    @param Y           Y size of the image where they were detected.
+
+    @param filename    Name of the file to be written.
+ */
+void write_lsd_segments( double * segs, int n, int dim, int X, int Y,
+                         char * filename );
+
+/*----------------------------------------------------------------------------*/
+/** Read a binary line segment file.
+    If the name is "-" the file is read from standard input.
+
+    @param n           Pointer to an int where the number of line segments
+                       will be stored.
+
+    @param dim         Pointer to an int where the number of values per
+                       line segment will be stored.
+
+    @param X           Pointer to an int where the X size of the image
+                       will be stored. May be NULL.
+
+    @param Y           Pointer to an int where the Y size of the image
+                       will be stored. May be NULL.
+
+    @param filename    Name of the file to be read.
+
+    @return            A float array of size dim x n, where the values of
+                       line segment number 'k+1' are 'out[dim*k+0]' to
+                       'out[dim*k+dim-1]'. The memory is allocated with
+                       malloc() and should be freed by the caller.
+ */
+float * read_lsd_segments( int * n, int * dim, int * X, int * Y,
+                           char * filename );
+
+#endif /* !LSD_SEGS_HEADER */
+/*----------------------------------------------------------------------------*/
@@ -49,6 +49,10 @@ using namespace std;
 * @brief Compute the TV of MIRE-processed image for a set of parameter sigma
 * namely (SIGMA_MIN:DELTA:SIGMA_MAX).
 * Keep the one that minimizing the TV criterion and sent it back to the main.
+* The columns of the input are sorted once, the sigma is chosen by
+* MIRE_automatic_sigma and the image is processed once, with that sigma.
+* The image is not extended: the columns beyond its borders are indexed by
+* mirror symmetry (see mirror_column).
 * @param IMAGE input
 * @param w1 image width
 * @param h1 image height
@@ -65,71 +69,287 @@ void MIRE_automatic(float *IMAGE, int w1, int h1,int SIGMA_MIN, int SIGMA_MAX,
 /// two sigmas
 /// The function guess the optimal sigma "sigma_best "and applies a MIRE with
 /// "sigma_best"
-    float sigma_current;
     float sigma_best;
-    float TV_current;
-    float* Imtemp = new float[h1*w1];
-    float TV_min;
+
+//the columns of the input are the same for all sigmas: sorted only once
+    std::vector <float> c_sorted;
+    c_sorted=column_sorting(IMAGE,w1,h1);
+
+
 
 //////////////////////////////////////////////////////////////////////////////
-//////////////////////////////INITIALIZATION STEP/////////////////////////////
+//////////////////////////////GUESSING THE BEST SIGMA/////////////////////////
 //////////////////////////////////////////////////////////////////////////////
 
-    sigma_best=SIGMA_MIN;
-    for (int i=0;i<w1*h1;i++)
-        Imtemp[i]=IMAGE[i];
+    sigma_best=MIRE_automatic_sigma(IMAGE,c_sorted,w1,h1,SIGMA_MIN,SIGMA_MAX,
+                                    DELTA);
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+////////////////APPLYING MIRE WITH THE BEST SIGMA PARAMETER///////////////////
+//////////////////////////////////////////////////////////////////////////////
+    if (sigma_best!=0) MIRE_sorted(IMAGE,c_sorted,sigma_best,w1,h1);
+    printf("SIGMA_BEST: %f\n", sigma_best);
+}
+
+
+
+
+
+
+/**
+* @fn float MIRE_automatic_sigma(float *IMAGE,
+* const std::vector <float> &c_sorted, int w1, int h1,int SIGMA_MIN,
+* int SIGMA_MAX, float DELTA)
+* @brief The sigma chosen by MIRE_automatic, without processing the image:
+* the TV of each sigma is evaluated with TV_MIRE, so no copy of the image is
+* needed. The ranks of the pixels in their columns do not depend on sigma:
+* they are computed once (see column_ranks) and shared by all the sigmas
+* (see TV_MIRE_ranked). The sigmas are evaluated in parallel (with OpenMP)
+* and the first one reaching the minimal TV, in the order of the sigmas, is
+* kept, so the result does not depend on the number of threads.
+* @param IMAGE input
+* @param c_sorted sorted columns of IMAGE (see column_sorting)
+* @param w1 image width
+* @param h1 image height
+* @param SIGMA_MIN
+* @param SIGMA_MAX
+* @param DELTA : step between two sigmas
+* @return sigma_best
+*/
+
+float MIRE_automatic_sigma(float *IMAGE, const std::vector <float> &c_sorted,
+                           int w1, int h1,int SIGMA_MIN, int SIGMA_MAX,
+                           float DELTA)
+{
+    std::vector <float> sigma=sigma_grid(SIGMA_MIN,SIGMA_MAX,DELTA);
+    int T=sigma.size();
+    std::vector <float> TV(T);
+
+//the ranks of the pixels are the same for all sigmas
+    std::vector <int> rank;
+    rank=column_ranks(IMAGE,c_sorted,w1,h1);
+
+#pragma omp parallel for schedule(dynamic)
+    for (int i=0;i<T;i++)
+        TV[i]=TV_MIRE_ranked(rank,c_sorted,sigma[i],w1,h1);
+
+//keep the first sigma reaching the minimal TV, in the order of the sigmas
+    int best=0;
+    for (int i=1;i<T;i++)
+        if (TV[i]<TV[best]) best=i;
+    return(sigma[best]);
+}
+
 
 
-    if (SIGMA_MIN==0)
-    {
-        TV_current=TV_column_norm(Imtemp,w1,h1,4*SIGMA_MAX);
-    }
-    else
-    {
-        TV_current=TV_column_norm(MIRE(Imtemp,SIGMA_MIN,w1,h1),w1,h1,
-                                  4*SIGMA_MAX);
-    }
-    TV_min=TV_current;
-    sigma_current=SIGMA_MIN;
+
+
+
+/**
+* @fn void MIRE_search(float *IMAGE, int w1, int h1,int SIGMA_MIN, int
+* SIGMA_MAX, float DELTA, int ROW_STEP)
+* @brief Same as MIRE_automatic, but the sigma minimizing the TV criterion is
+* searched with a coarse-to-fine optimizer instead of testing every sigma of
+* (SIGMA_MIN:DELTA:SIGMA_MAX).
+*  Implemented in 2 steps:
+*  Step1 : coarse grid, every COARSE_STEP sigmas of the fine grid
+*  Step2 : golden-section search on the fine grid, between the two coarse
+*  neighbors of the best coarse sigma
+*  Each sigma is evaluated once with TV_MIRE, on the lines multiple of
+*  ROW_STEP only. Ties are broken towards the smallest sigma, as in
+*  MIRE_automatic. The chosen sigma and the number of evaluations are
+*  printed.
+* @param IMAGE input
+* @param w1 image width
+* @param h1 image height
+* @param SIGMA_MIN
+* @param SIGMA_MAX
+* @param DELTA : step between two sigmas of the fine grid
+* @param ROW_STEP : one line out of ROW_STEP is used to evaluate the TV
+*
+*/
+
+void MIRE_search(float *IMAGE, int w1, int h1,int SIGMA_MIN, int SIGMA_MAX,
+                 float DELTA, int ROW_STEP)
+{
+/// Arguments : image,  image size, SIGMA_MIN, SIGMA_MAX, DELTA : step between
+/// two sigmas, ROW_STEP : subsampling of the lines for the TV
+/// The function guess the optimal sigma "sigma_best "and applies a MIRE with
+/// "sigma_best"
+    float sigma_best;
+    int evaluations;
+
+//the columns of the input are the same for all sigmas: sorted only once
+    std::vector <float> c_sorted;
+    c_sorted=column_sorting(IMAGE,w1,h1);
+
+    sigma_best=MIRE_search_sigma(IMAGE,c_sorted,w1,h1,SIGMA_MIN,SIGMA_MAX,
+                                 DELTA,ROW_STEP,&evaluations);
 
 
 
 //////////////////////////////////////////////////////////////////////////////
-//////////////////////////////GUESSING THE BEST SIGMA/////////////////////////
+////////////////APPLYING MIRE WITH THE BEST SIGMA PARAMETER///////////////////
 //////////////////////////////////////////////////////////////////////////////
+    if (sigma_best!=0) MIRE_sorted(IMAGE,c_sorted,sigma_best,w1,h1);
+    printf("SIGMA_BEST: %f\n", sigma_best);
+    printf("EVALUATIONS: %d (out of %d sigmas, one line out of %d)\n",
+           evaluations, (int) sigma_grid(SIGMA_MIN,SIGMA_MAX,DELTA).size(),
+           ROW_STEP < 1 ? 1 : ROW_STEP);
+}
 
 
 
-    int T=round(((SIGMA_MAX-SIGMA_MIN)/DELTA))+1;
 
-#pragma omp for
-    for ( int i=0;i<T; i++)
+/**
+* @fn float MIRE_search_sigma(float *IMAGE,
+* const std::vector <float> &c_sorted, int w1, int h1,int SIGMA_MIN,
+* int SIGMA_MAX, float DELTA, int ROW_STEP, int *evaluations)
+* @brief Coarse-to-fine search of the sigma minimizing the TV criterion, as
+* described in MIRE_search. The image is not modified.
+* @param IMAGE input
+* @param c_sorted sorted columns of IMAGE (see column_sorting)
+* @param w1 image width
+* @param h1 image height
+* @param SIGMA_MIN
+* @param SIGMA_MAX
+* @param DELTA : step between two sigmas of the fine grid
+* @param ROW_STEP : one line out of ROW_STEP is used to evaluate the TV
+* @param evaluations : output, number of sigmas evaluated (may be NULL)
+* @return sigma_best
+*/
+
+float MIRE_search_sigma(float *IMAGE, const std::vector <float> &c_sorted,
+                        int w1, int h1,int SIGMA_MIN, int SIGMA_MAX,
+                        float DELTA, int ROW_STEP, int *evaluations)
+{
+    const int COARSE_STEP=4; // fine grid steps between two coarse sigmas
+    int n_evaluations=0;
+
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////////INITIALIZATION STEP/////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+
+    if (ROW_STEP<1) ROW_STEP=1;
+
+//the fine grid SIGMA_MIN, SIGMA_MIN+DELTA, ... and its TV values, computed
+//when needed
+    std::vector <float> sigma=sigma_grid(SIGMA_MIN,SIGMA_MAX,DELTA);
+    int T=sigma.size();
+    std::vector <float> TV(T);
+    std::vector <bool> evaluated(T,false);
+
+
+
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////////STEP 1: COARSE GRID/////////////////////////////
+//////////////////////////////////////////////////////////////////////////////
+
+    std::vector <int> coarse;
+    for (int i=0;i<T;i+=COARSE_STEP)
+        coarse.push_back(i);
+    if (coarse.back()!=T-1) coarse.push_back(T-1);
+
+#pragma omp parallel for schedule(dynamic)
+    for (int k=0;k<(int) coarse.size();k++)
     {
+        TV[coarse[k]]=TV_MIRE(IMAGE,c_sorted,sigma[coarse[k]],w1,h1,
+                              ROW_STEP);
+    }
+    for (int k=0;k<(int) coarse.size();k++)
+        evaluated[coarse[k]]=true;
+    n_evaluations+=coarse.size();
+
+    int best=0;
+    for (int k=1;k<(int) coarse.size();k++)
+        if (TV[coarse[k]]<TV[best]) best=coarse[k];
 
-        for (int i=0;i<w1*h1;i++)
-            Imtemp[i]=IMAGE[i];
 
-        TV_current=TV_column_norm(MIRE(Imtemp,sigma_current,w1,h1),w1,h1,
-                                  4*SIGMA_MAX);
 
-        if (TV_current<TV_min)
+//////////////////////////////////////////////////////////////////////////////
+//////////////////////////////STEP 2: GOLDEN-SECTION SEARCH///////////////////
+//////////////////////////////////////////////////////////////////////////////
+
+    const float INVPHI=0.6180339887; // 1/golden ratio
+    int a=best-COARSE_STEP < 0 ? 0 : best-COARSE_STEP;
+    int b=best+COARSE_STEP > T-1 ? T-1 : best+COARSE_STEP;
+    while (b-a>2)
+    {
+// two inner points of [a,b] on the fine grid
+        int c=b-(int) round(INVPHI*(b-a));
+        int d=a+(int) round(INVPHI*(b-a));
+        if (c<=a) c=a+1;
+        if (d>=b) d=b-1;
+        if (d<=c) d=c+1;
+        int inner[2]={c,d};
+        for (int k=0;k<2;k++)
+        {
+            if (!evaluated[inner[k]])
+            {
+                TV[inner[k]]=TV_MIRE(IMAGE,c_sorted,sigma[inner[k]],w1,h1,
+                                     ROW_STEP);
+                evaluated[inner[k]]=true;
+                n_evaluations++;
+            }
+        }
+        if (TV[c]<=TV[d]) b=d;
+        else a=c;
+    }
+
+//the remaining (at most 3) sigmas
+    for (int i=a;i<=b;i++)
+    {
+        if (!evaluated[i])
         {
-            sigma_best=sigma_current;
-            TV_min=TV_current;
+            TV[i]=TV_MIRE(IMAGE,c_sorted,sigma[i],w1,h1,ROW_STEP);
+            evaluated[i]=true;
+            n_evaluations++;
         }
-        sigma_current=sigma_current+DELTA;
     }
-    delete [] Imtemp;
 
+//the best of all the evaluated sigmas, the bracket ends included
+    best=-1;
+    for (int i=0;i<T;i++)
+        if (evaluated[i] && (best<0 || TV[i]<TV[best])) best=i;
 
+    if (evaluations!=NULL) *evaluations=n_evaluations;
+    return(sigma[best]);
+}
 
 
 
-//////////////////////////////////////////////////////////////////////////////
-////////////////APPLYING MIRE WITH THE BEST SIGMA PARAMETER///////////////////
-//////////////////////////////////////////////////////////////////////////////
-    if (sigma_best!=0) MIRE(IMAGE,sigma_best,w1,h1);
-    printf("SIGMA_BEST: %f\n", sigma_best);
+
+
+
+/**
+* @fn std::vector <float> sigma_grid(int SIGMA_MIN, int SIGMA_MAX,
+* float DELTA)
+* @brief The sigmas tested by the automatic modes, (SIGMA_MIN:DELTA:SIGMA_MAX)
+* in Matlab notation. SIGMA_MIN is always tested.
+* @param SIGMA_MIN
+* @param SIGMA_MAX
+* @param DELTA : step between two sigmas
+* @return sigma, in increasing order
+*/
+
+std::vector <float> sigma_grid(int SIGMA_MIN, int SIGMA_MAX, float DELTA)
+{
+    float sigma_current;
+
+    int T=round(((SIGMA_MAX-SIGMA_MIN)/DELTA))+1;
+    if (T<1) T=1;
+
+//the sigmas to be tested, SIGMA_MIN, SIGMA_MIN+DELTA, ...
+    std::vector <float> sigma(T);
+    sigma_current=SIGMA_MIN;
+    for (int i=0;i<T;i++)
+    {
+        sigma[i]=sigma_current;
+        sigma_current=sigma_current+DELTA;
+    }
+    return(sigma);
 }
 
 
@@ -152,18 +372,70 @@ float *MIRE(float *IMAGE,float sigma, int w1, int h1)
 /// Arguments : image, std-dev of gaussian, image size.
 ///  output image processed with sdt-dev equal to sigma
 
-    std::vector <std::vector<float> > v;
-    std::vector <std::vector<float> > c_sorted;
+    std::vector <float> c_sorted;
     c_sorted=column_sorting(IMAGE,w1,h1);  //permits to sorts all columns.
-    v=target_histogram(c_sorted,w1,h1,sigma);
+    return(MIRE_sorted(IMAGE,c_sorted,sigma,w1,h1));
 
-    int N=round(4*sigma);
-    for (int column=N; column<w1-N;column++)
-    {
-// avoiding parts added by mirror-symetrization
+}
 
+
+
+
+/**
+* @fn float *MIRE_sorted(float *IMAGE,
+* const std::vector <float> &c_sorted,float sigma, int w1,
+* int h1)
+* @brief Performs the MIRE algorithm with parameter sigma, given the sorted
+* columns of IMAGE (as computed by column_sorting). All the columns are
+* processed, the columns beyond the borders being mirrored.
+* @param IMAGE input
+* @param c_sorted sorted columns of IMAGE (see column_sorting)
+* @param sigma
+* @param w1 image width
+* @param h1 image height
+* @return IMAGE
+*/
+
+float *MIRE_sorted(float *IMAGE,
+                   const std::vector <float> &c_sorted,
+                   float sigma, int w1, int h1)
+{
+/// Arguments : image, sorted columns of the image, std-dev of gaussian,
+/// image size.
+///  output image processed with sdt-dev equal to sigma
+
+    std::vector <float> v;
+    return(MIRE_sorted(IMAGE,c_sorted,sigma,w1,h1,v));
+}
+
+
+
+
+/**
+* @fn float *MIRE_sorted(float *IMAGE,
+* const std::vector <float> &c_sorted,float sigma, int w1,
+* int h1, std::vector <float> &v)
+* @brief Same as MIRE_sorted, the target values being computed in the
+* buffer v, that can be reused from one image to the next.
+* @param IMAGE input
+* @param c_sorted sorted columns of IMAGE (see column_sorting)
+* @param sigma
+* @param w1 image width
+* @param h1 image height
+* @param v buffer for the target values
+* @return IMAGE
+*/
+
+float *MIRE_sorted(float *IMAGE,
+                   const std::vector <float> &c_sorted,
+                   float sigma, int w1, int h1, std::vector <float> &v)
+{
+    target_histogram(c_sorted,w1,h1,sigma,v);
+
+    for (int column=0; column<w1;column++)
+    {
 // v is the target histogram in the sense of a midway weighted histogram
-        specify_column(IMAGE,w1,h1,column,v[column-N]);
+        specify_column(IMAGE,w1,h1,column,&v[column*h1]);
 //Giving the column "column" the histogram v
 
     }
@@ -175,25 +447,296 @@ float *MIRE(float *IMAGE,float sigma, int w1, int h1)
 
 
 /**
-* @fn float TV_column_norm(float *IMAGE, int w1, int h1,float B)
-* @brief Compute TV-norm among colums (avoids the parts added by
-symetrization).
+* @fn void MIRE_approximate(float *IMAGE, int w1, int h1,int SIGMA_MIN,
+* int SIGMA_MAX, float DELTA, int Q)
+* @brief Approximate MIRE_automatic for tall images: each column is
+* represented by Q quantiles (see column_quantiles) instead of its h1 sorted
+* values. The midway histograms are computed on the quantiles and the pixels
+* are specified by interpolation between them (see quantile_map), so the
+* memory and the cost of the midway histograms do not depend on h1.
+*  Every sigma of (SIGMA_MIN:DELTA:SIGMA_MAX) is evaluated with
+*  TV_MIRE_quantiles, in parallel, and the first sigma reaching the minimal TV
+*  is kept, as in MIRE_automatic. The pairs of horizontal neighbors are
+*  counted once on the grid of the quantiles (see quantile_pairs), so the
+*  cost of a sigma does not depend on h1. With Q=h1 the result is the one of
+*  MIRE_automatic.
+* @param IMAGE input
+* @param w1 image width
+* @param h1 image height
+* @param SIGMA_MIN
+* @param SIGMA_MAX
+* @param DELTA : step between two sigmas
+* @param Q : number of quantiles per column
+*/
+
+void MIRE_approximate(float *IMAGE, int w1, int h1,int SIGMA_MIN,
+                      int SIGMA_MAX, float DELTA, int Q)
+{
+/// Arguments : image,  image size, SIGMA_MIN, SIGMA_MAX, DELTA : step between
+/// two sigmas, Q : number of quantiles per column
+/// The function guess the optimal sigma "sigma_best "and applies an
+/// approximate MIRE with "sigma_best"
+    float sigma_best;
+
+    if (Q<2) Q=2;
+
+    std::vector <float> sigma=sigma_grid(SIGMA_MIN,SIGMA_MAX,DELTA);
+    int T=sigma.size();
+    std::vector <float> TV(T);
+
+//the quantiles of the columns and the pairs of neighbors on their grid are
+//the same for all sigmas
+    std::vector <float> quantiles;
+    quantiles=column_quantiles(IMAGE,w1,h1,Q);
+    std::vector <int> start;
+    std::vector <int> pairs;
+    pairs=quantile_pairs(IMAGE,quantiles,w1,h1,Q,start);
+
+#pragma omp parallel for schedule(dynamic)
+    for (int i=0;i<T;i++)
+        TV[i]=TV_MIRE_quantiles(pairs,start,quantiles,sigma[i],w1,Q);
+
+//keep the first sigma reaching the minimal TV, in the order of the sigmas
+    int best=0;
+    for (int i=1;i<T;i++)
+        if (TV[i]<TV[best]) best=i;
+    sigma_best=sigma[best];
+
+    if (sigma_best!=0) MIRE_quantiles(IMAGE,quantiles,sigma_best,w1,h1,Q);
+    printf("SIGMA_BEST: %f\n", sigma_best);
+    printf("QUANTILES: %d per column (column height %d)\n", Q, h1);
+}
+
+
+
+
+/**
+* @fn float *MIRE_quantiles(float *IMAGE,
+* const std::vector <float> &quantiles, float sigma, int w1, int h1, int Q)
+* @brief Performs the approximate MIRE algorithm with parameter sigma, given
+* the Q quantiles of the columns of IMAGE (as computed by column_quantiles)
+* @param IMAGE input
+* @param quantiles quantiles of the columns of IMAGE
+* @param sigma
+* @param w1 image width
+* @param h1 image height
+* @param Q number of quantiles per column
+* @return IMAGE
+*/
+
+float *MIRE_quantiles(float *IMAGE, const std::vector <float> &quantiles,
+                      float sigma, int w1, int h1, int Q)
+{
+/// the target quantiles are the midway histogram of the quantiles
+    std::vector <float> v;
+    v=target_histogram(quantiles,w1,Q,sigma);
+
+#pragma omp parallel for
+    for (int line=0;line<h1;line++)
+    {
+        for (int column=0;column<w1;column++)
+        {
+            IMAGE[line*w1+column]=quantile_map(IMAGE[line*w1+column],
+                                               &quantiles[column*Q],
+                                               &v[column*Q],Q);
+        }
+    }
+    return(IMAGE);
+}
+
+
+
+
+/**
+* Number of steps of the quantile grid between two quantiles
+*/
+#define QUANTILE_STEPS 4
+
+/**
+* @fn int quantile_position(float value, const float *q, int Q)
+* @brief Position of value on the quantile grid: the value is located
+* between two quantiles as in quantile_map, and rounded to the nearest of
+* the QUANTILE_STEPS steps between them. A value equal to a run of
+* quantiles gets the last one, as in specify_column; values outside the
+* quantiles get the extreme one.
+* @param value value to be located
+* @param q the Q quantiles of the column, in increasing order
+* @param Q number of quantiles
+* @return position in [0,(Q-1)*QUANTILE_STEPS], the quantile k being at
+* k*QUANTILE_STEPS
+*/
+static int quantile_position(float value, const float *q, int Q)
+{
+    if (value>=q[Q-1]) return((Q-1)*QUANTILE_STEPS);
+// q[k-1] <= value < q[k]
+    int k=std::upper_bound(q,q+Q,value)-q;
+    if (k==0) return(0);
+    float t=(value-q[k-1])/(q[k]-q[k-1]);
+    return((k-1)*QUANTILE_STEPS+(int) floor(t*QUANTILE_STEPS+0.5));
+}
+
+
+
+/**
+* @fn std::vector <int> quantile_pairs(float *IMAGE,
+* const std::vector <float> &quantiles, int w1, int h1, int Q,
+* std::vector <int> &start)
+* @brief Pairs of horizontal neighbors of the image on the grid of the
+* quantiles of the columns: each pixel is located on the grid of its column
+* (see quantile_position), once, and the pairs (i,j) of positions of the
+* pixels (line,column) and (line,column+1) are counted. The lines are
+* sorted by pair with two counting sorts, so the cost is O(h1+Q) per column.
+* There are at most min(h1,(Q*QUANTILE_STEPS)^2) pairs per column.
+* @param IMAGE input
+* @param quantiles quantiles of the columns of IMAGE (see column_quantiles)
+* @param w1 image width
+* @param h1 image height
+* @param Q number of quantiles per column
+* @param start output, w1 values: the pairs of the columns column and
+* column+1 are the pairs start[column] ... start[column+1]-1
+* @return pairs, 3 values per pair: i, j and the number of lines
+*/
+std::vector <int> quantile_pairs(float *IMAGE,
+                                 const std::vector <float> &quantiles,
+                                 int w1, int h1, int Q,
+                                 std::vector <int> &start)
+{
+    const int G=(Q-1)*QUANTILE_STEPS+1; // positions on the grid
+    std::vector <int> pairs;
+    std::vector <int> current(h1), next(h1);
+    std::vector <int> count(G+1), by_next(h1), sorted(h1);
+    start.assign(w1,0);
+    for (int column=0;column<w1;column++)
+    {
+        const float *q=&quantiles[column*Q];
+        for (int line=0;line<h1;line++)
+            next[line]=quantile_position(IMAGE[line*w1+column],q,Q);
+        if (column>0)
+        {
+//the lines sorted by pair of positions (current,next): counting sort by
+//next, then stable counting sort by current
+            count.assign(G+1,0);
+            for (int line=0;line<h1;line++)
+                count[next[line]+1]++;
+            for (int i=0;i<G;i++)
+                count[i+1]=count[i+1]+count[i];
+            for (int line=0;line<h1;line++)
+                by_next[count[next[line]]++]=line;
+            count.assign(G+1,0);
+            for (int line=0;line<h1;line++)
+                count[current[line]+1]++;
+            for (int i=0;i<G;i++)
+                count[i+1]=count[i+1]+count[i];
+            for (int k=0;k<h1;k++)
+                sorted[count[current[by_next[k]]]++]=by_next[k];
+
+//the runs of equal pairs
+            start[column-1]=pairs.size()/3;
+            for (int k=0;k<h1;)
+            {
+                const int i=current[sorted[k]], j=next[sorted[k]];
+                int last=k;
+                while (last+1<h1 && current[sorted[last+1]]==i
+                       && next[sorted[last+1]]==j)
+                    last++;
+                pairs.push_back(i);
+                pairs.push_back(j);
+                pairs.push_back(last-k+1);
+                k=last+1;
+            }
+        }
+        current.swap(next);
+    }
+    start[w1-1]=pairs.size()/3;
+    return(pairs);
+}
+
+
+
+/**
+* @fn float TV_MIRE_quantiles(const std::vector <int> &pairs,
+* const std::vector <int> &start, const std::vector <float> &quantiles,
+* float sigma, int w1, int Q)
+* @brief TV-norm among columns of
+* MIRE_quantiles(IMAGE,quantiles,sigma,w1,h1,Q) evaluated on the quantile
+* grid alone: the targets are interpolated at the steps of the grid, as in
+* quantile_map, each pixel is represented by the target of its position
+* (see quantile_position), and each pair of neighbors of quantile_pairs
+* contributes its number of lines times the absolute difference of their
+* targets. The cost is O(w1*Q) plus the number of pairs. With Q=h1 the
+* positions are the ranks, and the TV is the one of TV_MIRE up to the order
+* of the sums. For sigma=0 the targets are the quantiles (image not
+* processed).
+* @param pairs pairs of neighbors on the quantile grid (see quantile_pairs)
+* @param start first pair of each column (see quantile_pairs)
+* @param quantiles quantiles of the columns of the image
+* @param sigma std-dev of the Gaussian.
+* @param w1 image width
+* @param Q number of quantiles per column
+* @return TV
+*/
+
+float TV_MIRE_quantiles(const std::vector <int> &pairs,
+                        const std::vector <int> &start,
+                        const std::vector <float> &quantiles,
+                        float sigma, int w1, int Q)
+{
+    std::vector <float> v;
+    if (sigma==0)
+        v=quantiles;
+    else
+        v=target_histogram(quantiles,w1,Q,sigma);
+
+//the targets at the steps of the grid
+    const int G=(Q-1)*QUANTILE_STEPS+1;
+    std::vector <float> grid(w1*G);
+    for (int column=0;column<w1;column++)
+    {
+        const float *t=&v[column*Q];
+        for (int k=0;k<Q-1;k++)
+        {
+            for (int step=0;step<QUANTILE_STEPS;step++)
+            {
+                float a=(float) step/QUANTILE_STEPS;
+                grid[column*G+k*QUANTILE_STEPS+step]=(1-a)*t[k]+a*t[k+1];
+            }
+        }
+        grid[column*G+G-1]=t[Q-1];
+    }
+
+    float TV=0;
+    for (int column=0;column<w1-1;column++)
+    {
+        const float *t0=&grid[column*G], *t1=&grid[(column+1)*G];
+        for (int p=start[column];p<start[column+1];p++)
+        {
+            const int *pair=&pairs[3*p];
+            TV=TV+pair[2]*ABS(t1[pair[1]]-t0[pair[0]]);
+        }
+    }
+
+    return(TV);
+}
+
+
+
+
+/**
+* @fn float TV_column_norm(float *IMAGE, int w1, int h1)
+* @brief Compute TV-norm among colums.
 *@param IMAGE : input
 * @param w1 image width
 * @param h1 image height
-* @param B number of columns added by symetrization.
 * @return TV
 */
 
 
-float TV_column_norm(float *IMAGE, int w1, int h1,float B)
+float TV_column_norm(float *IMAGE, int w1, int h1)
 {
-/// Arguments : image, width, length, B: number of columns added by
-/// symetrization.
-///  Computing the TV-norm among columns avoiding the parts added by
-/// symetrization.
+/// Arguments : image, width, length.
+///  Computing the TV-norm among columns.
     float TV=0;
-    for (int column=B;column<w1-B;column++)
+    for (int column=0;column<w1-1;column++)
     {
         for (int line=0;line<h1;line++)
         {
@@ -209,6 +752,163 @@ float TV_column_norm(float *IMAGE, int w1, int h1,float B)
 
 
 
+/**
+* @fn float TV_MIRE(float *IMAGE,
+* const std::vector <float> &c_sorted, float sigma, int w1,
+* int h1, int ROW_STEP)
+* @brief Compute the TV-norm among columns of MIRE(IMAGE,sigma), on the lines
+* multiple of ROW_STEP only, without computing the processed image.
+*  The value of a processed pixel is the target value of its rank in its
+*  column: the rank is found by a binary search in the sorted column (the last
+*  rank of a run of equal values, as in specify_column) and the target value
+*  is computed for that rank only, as in target_histogram. With ROW_STEP=1 the
+*  result is the same as TV_column_norm(MIRE(IMAGE,sigma,w1,h1),w1,h1).
+*  For sigma=0 the image is not processed, as in MIRE_automatic.
+* @param IMAGE input (not modified)
+* @param c_sorted sorted columns of IMAGE (see column_sorting)
+* @param sigma std-dev of the Gaussian.
+* @param w1 image width
+* @param h1 image height
+* @param ROW_STEP one line out of ROW_STEP is used
+* @return TV
+*/
+
+
+float TV_MIRE(float *IMAGE, const std::vector <float> &c_sorted,
+              float sigma, int w1, int h1, int ROW_STEP)
+{
+/// Arguments : image, sorted columns, std-dev of gaussian, image size,
+/// ROW_STEP: line subsampling.
+    int N= sigma==0 ? 0 : round(4*sigma);
+    std::vector <float> weight;
+    if (N>0) weight=gaussian_weights(sigma,N);
+
+    std::vector <float> current;
+    std::vector <float> next;
+    float TV=0;
+    for (int column=0;column<w1-1;column++)
+    {
+        if (column==0)
+            processed_column(IMAGE,c_sorted,weight,N,w1,h1,column,ROW_STEP,
+                             next);
+        current.swap(next);
+        processed_column(IMAGE,c_sorted,weight,N,w1,h1,column+1,ROW_STEP,next);
+        for (int k=0;k<(int) current.size();k++)
+        {
+
+
+            TV=TV+ABS(next[k]-current[k]);
+
+        }
+    }
+
+    return(TV);
+}
+
+
+
+/**
+* @fn float TV_MIRE_ranked(const std::vector <int> &rank,
+* const std::vector <float> &c_sorted, float sigma, int w1, int h1)
+* @brief Same as TV_MIRE with ROW_STEP=1, given the ranks of the pixels in
+* their columns (see column_ranks). The target values of a column are
+* computed for all the ranks at once, as in target_histogram, and the
+* processed pixels are read from them by rank, so the cost of a sigma does
+* not include any search in the sorted columns.
+* @param rank ranks of the pixels of the image (see column_ranks)
+* @param c_sorted sorted columns of the image (see column_sorting)
+* @param sigma std-dev of the Gaussian.
+* @param w1 image width
+* @param h1 image height
+* @return TV
+*/
+
+float TV_MIRE_ranked(const std::vector <int> &rank,
+                     const std::vector <float> &c_sorted,
+                     float sigma, int w1, int h1)
+{
+    int N= sigma==0 ? 0 : round(4*sigma);
+    std::vector <float> weight;
+    if (N>0) weight=gaussian_weights(sigma,N);
+
+    std::vector <float> target(h1);
+    std::vector <float> current(h1);
+    std::vector <float> next(h1);
+    float TV=0;
+    for (int column=0;column<w1;column++)
+    {
+//target values of the column, the terms being added in the order of
+//target_histogram; for sigma=0 the sorted column itself
+        const float *v=&c_sorted[column*h1];
+        if (N>0)
+        {
+            target.assign(h1,0);
+            for (int vcolumn=column-N; vcolumn<column+N+1;vcolumn++)
+            {
+                const float g=weight[N+column-vcolumn];
+                const float *sorted=&c_sorted[mirror_column(vcolumn,w1)*h1];
+                for (int vline=0;vline<h1;vline++)
+                    target[vline]=target[vline]+g*sorted[vline];
+            }
+            v=&target[0];
+        }
+        for (int line=0;line<h1;line++)
+            next[line]=v[rank[line*w1+column]];
+
+        if (column>0)
+        {
+            for (int line=0;line<h1;line++)
+                TV=TV+ABS(next[line]-current[line]);
+        }
+        current.swap(next);
+    }
+
+    return(TV);
+}
+
+
+
+/**
+* @fn void processed_column(float *IMAGE,
+* const std::vector <float> &c_sorted,
+* const std::vector <float> &weight, int N, int w1, int h1, int column,
+* int ROW_STEP, std::vector <float> &values)
+* @brief Values of the column "column" of MIRE(IMAGE,sigma), on the lines
+* multiple of ROW_STEP, given the Gaussian weights of sigma and its radius N.
+* The columns beyond the borders are mirrored (see mirror_column).
+*/
+void processed_column(float *IMAGE,
+                      const std::vector <float> &c_sorted,
+                      const std::vector <float> &weight, int N, int w1, int h1,
+                      int column, int ROW_STEP, std::vector <float> &values)
+{
+    values.clear();
+//offsets of the sorted columns column-N ... column+N, mirrored
+    std::vector <int> offset(2*N+1);
+    for (int vcolumn=column-N; vcolumn<column+N+1;vcolumn++)
+        offset[vcolumn-column+N]=mirror_column(vcolumn,w1)*h1;
+
+    for (int line=0;line<h1;line+=ROW_STEP)
+    {
+        float temp=IMAGE[line*w1+column];
+        if (N>0)
+        {
+//rank of the value: last one of its run in the sorted column
+            const float *sorted=&c_sorted[column*h1];
+            int rank=std::upper_bound(sorted,sorted+h1,temp)-sorted-1;
+            temp=0;
+            for (int vcolumn=column-N; vcolumn<column+N+1;vcolumn++)
+            {
+                temp=temp+weight[N+column-vcolumn]
+                     *(c_sorted[offset[vcolumn-column+N]+rank]);
+            }
+        }
+        values.push_back(temp);
+    }
+}
+
+
+
 /**
 * @fn float gaussian(int x,float sigma)
 * @brief Evaluate the Gaussian function at x with std-dev sigma
@@ -224,37 +924,76 @@ float gaussian(int x,float sigma)
 
 
 
+/**
+* @fn std::vector <float> gaussian_weights(float sigma,int N)
+* @brief Gaussian weights of std-dev sigma on [-N,N], computed once per sigma
+* @param sigma std-dev of the gaussian
+* @param N radius
+* @return weight such that weight[N+x]=gaussian(x,sigma)
+*/
+std::vector <float> gaussian_weights(float sigma,int N)
+{
+    std::vector <float> weight(2*N+1);
+    for (int x=-N;x<=N;x++)
+        weight[N+x]=gaussian(x,sigma);
+    return(weight);
+}
+
+
+
+/**
+* @fn int mirror_column(int column,int w1)
+* @brief Index of a column of the image extended by mirror symmetry, as done
+* by borders: C2 C1 |C1 C2 ... CN|CN CN-1, the column -k being the column k
+* and the column w1+k the column w1-1-k. Reflected again if needed, so any
+* radius is valid.
+* @param column index of the column, possibly outside [0,w1)
+* @param w1 image width
+* @return index in [0,w1)
+*/
+int mirror_column(int column,int w1)
+{
+    if (w1<2) return(0);
+    while (column<0 || column>=w1)
+        column= column<0 ? -column : 2*w1-1-column;
+    return(column);
+}
+
+
+
 /**
 * @fn void specify_column(float *IMAGE, int w1, int h1,int column_current,
-* std::vector <float> target_values)
+* const float *target_values)
 * @brief Given the vector containing the target value. Specify he column on
 * theses values
 *  Implemented in 2 steps:
-*  Step1: sort v_column put it in column_sorted
-*  Step2: for each entry v_column(i) find indice j of column_sorted such that
-* column_sorted(j)==v_column(i)
-*  change v_column(j) to  v_column(j)=target_values(j)
+*  Step1: argsort v_column: sort the pairs (v_column(i),i) in column_sorted
+*  Step2: for each rank j, the pixel i of column_sorted(j) gets
+*  v_column(i)=target_values(j)
+*  Equal values get the same target value, the one of the last rank of their
+*  run in column_sorted, so ties are handled deterministically.
+*  The cost is O(h1 log h1) per column.
 * @param IMAGE input
 * @param w1 image width
 * @param h1 image height
 * @param column_current the index of the column to process
-* @param target_values vector containing the values to apply
+* @param target_values the h1 values to apply, in increasing order
 *
 */
 
 
 void specify_column(float *IMAGE, int w1, int h1,int column_current,
-                    std::vector <float> target_values)
+                    const float *target_values)
 {
 /// given a column (vector) of the image (v_column) an a vector containing
 /// target values (target_values) change the values of the image such that
 ///  the min (c_i):=target_values(0), the next value of c_i changes to
 /// target_values(1) and so on
 ///  Implemented in 2 steps:
-///  Step1: sort v_column put it in column_sorted
-///  Step2: for each entry v_column(i) find indice j of column_sorted such that
-/// column_sorted(j)==v_column(i)
-///  change v_column(j) to  v_column(j)=target_values(j)
+///  Step1: argsort v_column: sort the pairs (v_column(i),i) in column_sorted
+///  Step2: for each rank j, the pixel i of column_sorted(j) gets
+///  v_column(i)=target_values(j); a run of equal values gets the target
+///  value of its last rank.
 
 
 
@@ -264,11 +1003,11 @@ void specify_column(float *IMAGE, int w1, int h1,int column_current,
 //////////////////////////////STEP 1//////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////
 
-    std::vector <float> column_sorted;
+    std::vector <std::pair<float,int> > column_sorted(h1);
     for (int i=0;i<h1;i++)
     {
-//for all lines.
-        column_sorted.push_back(IMAGE[i*w1+column_current]);
+//for all lines: value and line index.
+        column_sorted[i]=std::make_pair(IMAGE[i*w1+column_current],i);
     }
     std::sort (column_sorted.begin(), column_sorted.end());
 
@@ -279,17 +1018,18 @@ void specify_column(float *IMAGE, int w1, int h1,int column_current,
 //////////////////////////////////////////////////////////////////////////////
 
 
-    for (int i=0;i<h1;i++)
+    for (int j=0;j<h1;)
     {
-        float temp= IMAGE[i*w1+column_current] ; //IMAGE[i*w1+column_current]
-        //is v_column(i) in the above description
-        for (int j=0;j<h1;j++)
+//[j,last] is a run of equal values in column_sorted
+        int last=j;
+        while (last+1<h1 && column_sorted[last+1].first==column_sorted[j].first)
+            last++;
+        for (int k=j;k<=last;k++)
         {
-            if (temp==column_sorted[j])
-            {
-                IMAGE[i*w1+column_current]=target_values[j];
-            }
+            IMAGE[column_sorted[k].second*w1+column_current]=
+                target_values[last];
         }
+        j=last+1;
     }
 
 
@@ -297,8 +1037,8 @@ void specify_column(float *IMAGE, int w1, int h1,int column_current,
 
 
 /**
-* @fn std::vector <std::vector<float> >  target_histogram(std::vector
-* <std::vector<float> > V_HISTOS,int w1,int h1, float sigma)
+* @fn std::vector <float> target_histogram(const std::vector <float> &V_HISTOS,
+* int w1,int h1, float sigma)
 * @brief Compute the target vector (~ histogram)
 *  Implemented in 3 steps:
 *  Step1 : extract columns columns in the interval ["column"-4sigma,
@@ -307,14 +1047,36 @@ void specify_column(float *IMAGE, int w1, int h1,int column_current,
 *  Step3 : for all lines and all column of step2 compute the midway gaussian
 averaged ie :
 *  v(i)=WEIGHT(column).*(paquet(ligne,column)));
-* @param V_HISTOS vector containing sorted columns.
+*  Steps 1 & 2 are done once by column_sorting. Step 3 is computed as a 1-D
+*  convolution along the columns of the contiguous sorted buffer, with the
+*  Gaussian weights computed once. The columns beyond the borders are the
+*  sorted columns of their mirror (see mirror_column): no extended image is
+*  needed.
+* @param V_HISTOS sorted columns, column-major (see column_sorting).
 * @param w1 image width
 * @param h1 image height
 * @param sigma std-dev of the Gaussian.
-* @return FINAL
+* @return FINAL, column-major: the target values of column CENTER are
+* FINAL[CENTER*h1+line], for CENTER in [0,w1).
+*/
+std::vector <float> target_histogram(const std::vector <float> &V_HISTOS,
+                                     int w1,int h1, float sigma)
+{
+    std::vector <float> FINAL;
+    target_histogram(V_HISTOS,w1,h1,sigma,FINAL);
+    return(FINAL);
+}
+
+
+
+/**
+* @fn void target_histogram(const std::vector <float> &V_HISTOS,
+* int w1,int h1, float sigma, std::vector <float> &FINAL)
+* @brief Same as target_histogram, the target values being computed in the
+* buffer FINAL, that can be reused from one image to the next.
 */
-std::vector <std::vector<float> >  target_histogram(std::vector
-        <std::vector<float> > V_HISTOS,int w1,int h1, float sigma)
+void target_histogram(const std::vector <float> &V_HISTOS,
+                      int w1,int h1, float sigma, std::vector <float> &FINAL)
 {
 /// Compute the midway Gaussian averaged histogram. Gaussian weighted,
 /// troncated with radius equal to 4 sigma:
@@ -337,34 +1099,34 @@ std::vector <std::vector<float> >  target_histogram(std::vector
 //////////////////////////////STEPS 1 & 2/////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////
 
-
-    std::vector <std::vector<float> > FINAL;
+// done by column_sorting: V_HISTOS[column*h1+line]
 
 //Radius in pixels
     int N=round(4*sigma); // (depending on delta) could be non-integer.
+    std::vector <float> weight=gaussian_weights(sigma,N);
+
+    FINAL.assign(w1*h1,0);
 
 
 //////////////////////////////////////////////////////////////////////////////
 //////////////////////////////STEP 3//////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////
 
-
-    for (int CENTER=N; CENTER<w1-N;CENTER++)
+// for each line the terms are added in the order of vcolumn, the inner loop
+// runs over the contiguous lines of a sorted column
+    for (int CENTER=0; CENTER<w1;CENTER++)
     {
-        std::vector <float> v;
-        for (int vline=0;vline<h1;vline++)  //for each line of the "matrix"
+        float *v=&FINAL[CENTER*h1];
+        for (int vcolumn=CENTER-N; vcolumn<CENTER+N+1;vcolumn++)
         {
-            float temp=0;
-            for (int vcolumn=CENTER-N; vcolumn<CENTER+N+1;vcolumn++)
+            const float g=weight[N+CENTER-vcolumn];
+            const float *sorted=&V_HISTOS[mirror_column(vcolumn,w1)*h1];
+            for (int vline=0;vline<h1;vline++)  //for each line of the "matrix"
             {
-                temp=temp+gaussian((CENTER-vcolumn),sigma)
-                     *(V_HISTOS[vcolumn][vline]);
+                v[vline]=v[vline]+g*sorted[vline];
             }
-            v.push_back(temp);
         }
-        FINAL.push_back(v);
     }
-    return(FINAL);
 }
 
 
@@ -398,34 +1160,138 @@ std::vector <float> histo_column(float *IMAGE,int w1,int h1, int column)
 
 
 /**
-* @fn std::vector <std::vector<float> >  column_sorting(float *IMAGE,int w1,int
-* h1)
+* @fn std::vector <float> column_sorting(float *IMAGE,int w1,int h1)
 * @brief Sort all columns of the image
 * @param IMAGE input
 * @param w1 image width
 * @param h1 image height
-* @return V_HISTOS
+* @return V_HISTOS, column-major: the sorted column i is
+* V_HISTOS[i*h1] ... V_HISTOS[i*h1+h1-1]
 */
-std::vector <std::vector<float> >  column_sorting(float *IMAGE,int w1,int h1)
+std::vector <float> column_sorting(float *IMAGE,int w1,int h1)
 {
+    std::vector <float> V_HISTOS;
+    column_sorting(IMAGE,w1,h1,V_HISTOS);
+    return(V_HISTOS);
+}
 
 
 
-//Radius in pixels
-//int N=round(4*sigma); // (depending on delta) could be non-integer.
-
-    std::vector <std::vector<float> > V_HISTOS;
-// Vectors of vectors (matrix) such that
-//V_HISTOS[i] is the histogram of the column v (which is also a vector)
+/**
+* @fn void column_sorting(float *IMAGE,int w1,int h1,
+* std::vector <float> &V_HISTOS)
+* @brief Same as column_sorting, the sorted columns being stored in the
+* buffer V_HISTOS, that can be reused from one image to the next.
+*/
+void column_sorting(float *IMAGE,int w1,int h1, std::vector <float> &V_HISTOS)
+{
+    V_HISTOS.resize(w1*h1);
+// One contiguous buffer (matrix) such that
+//V_HISTOS[i*h1+line] is the histogram of the column i
     for (int i=0;i <w1;i++)   //processing all columns in the radius
     {
-        V_HISTOS.push_back(histo_column(IMAGE, w1, h1,  i));
-//step 2 is done in histo_column
+        float *v=&V_HISTOS[i*h1];
+        for (int line=0;line<h1;line++)
+            v[line]=IMAGE[line*w1+i];
+        std::sort (v, v+h1);
     }
-    return(V_HISTOS);
 }
 
 
 
+/**
+* @fn std::vector <int> column_ranks(float *IMAGE,
+* const std::vector <float> &c_sorted, int w1, int h1)
+* @brief Rank of each pixel in its sorted column: the last rank of the run of
+* its value, as in specify_column.
+* @param IMAGE input
+* @param c_sorted sorted columns of IMAGE (see column_sorting)
+* @param w1 image width
+* @param h1 image height
+* @return rank, with the layout of the image: rank[line*w1+column]
+*/
+std::vector <int> column_ranks(float *IMAGE,
+                               const std::vector <float> &c_sorted,
+                               int w1, int h1)
+{
+    std::vector <int> rank(w1*h1);
+    for (int line=0;line<h1;line++)
+    {
+        for (int column=0;column<w1;column++)
+        {
+            const float *sorted=&c_sorted[column*h1];
+            rank[line*w1+column]=std::upper_bound(sorted,sorted+h1,
+                                                  IMAGE[line*w1+column])
+                                 -sorted-1;
+        }
+    }
+    return(rank);
+}
+
+
+
+/**
+* @fn std::vector <float> column_quantiles(float *IMAGE,int w1,int h1,int Q)
+* @brief Q quantiles of each column of the image: the sorted column sampled
+* at the ranks k*(h1-1)/(Q-1), k=0..Q-1, with linear interpolation. The
+* columns are sorted one at a time, so only one column is stored in full.
+* With Q=h1 the quantiles are the sorted columns.
+* @param IMAGE input
+* @param w1 image width
+* @param h1 image height
+* @param Q number of quantiles per column (at least 2)
+* @return quantiles, column-major: the quantiles of the column i are
+* quantiles[i*Q] ... quantiles[i*Q+Q-1]
+*/
+std::vector <float> column_quantiles(float *IMAGE,int w1,int h1,int Q)
+{
+    std::vector <float> quantiles(w1*Q);
+    std::vector <float> column(h1);
+    for (int i=0;i<w1;i++)
+    {
+        for (int line=0;line<h1;line++)
+            column[line]=IMAGE[line*w1+i];
+        std::sort (column.begin(), column.end());
 
+        float *q=&quantiles[i*Q];
+        for (int k=0;k<Q;k++)
+        {
+            double position=(double) k*(h1-1)/(Q-1);
+            int rank=(int) position;
+            if (rank>=h1-1)
+            {
+                q[k]=column[h1-1];
+                continue;
+            }
+            float t=position-rank;
+            q[k]=(1-t)*column[rank]+t*column[rank+1];
+        }
+    }
+    return(quantiles);
+}
 
+
+
+/**
+* @fn float quantile_map(float value, const float *q, const float *target,
+* int Q)
+* @brief Monotone piecewise linear map sending the quantiles q of a column
+* to the target quantiles: the value is located between two quantiles
+* (the last one of a run of equal quantiles, as in specify_column) and
+* interpolated between the corresponding targets. Values outside the
+* quantiles are shifted by the offset of the extreme quantile.
+* @param value value to be mapped
+* @param q the Q quantiles of the column, in increasing order
+* @param target the Q target quantiles
+* @param Q number of quantiles
+* @return mapped value
+*/
+float quantile_map(float value, const float *q, const float *target, int Q)
+{
+    if (value>=q[Q-1]) return(value-q[Q-1]+target[Q-1]);
+// q[k-1] <= value < q[k]
+    int k=std::upper_bound(q,q+Q,value)-q;
+    if (k==0) return(value-q[0]+target[0]);
+    float t=(value-q[k-1])/(q[k]-q[k-1]);
+    return((1-t)*target[k-1]+t*target[k]);
+}
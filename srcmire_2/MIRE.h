@@ -22,24 +22,99 @@ float *MIRE( float [],float,int,int);
 //works on a copy of the image
 //(it's unsure wich sigma is the right one a first sight)
 /// Arguments : image, std-dev of the gaussian, image size.
+float *MIRE_sorted(float [],const std::vector <float> &,float,int,int);
+/// Arguments : image, sorted columns of the image (see column_sorting),
+/// std-dev of the gaussian, image size.
+float *MIRE_sorted(float [],const std::vector <float> &,float,int,int,
+                   std::vector <float> &);
+/// Arguments : image, sorted columns, std-dev of the gaussian, image size,
+/// buffer for the target values.
 void MIRE_automatic(float [],int, int,int,int,float);
 /// Arguments : image, image size, sigma_min,simga_max,sigma_step:
 //all sigma_min:sigma_step:sigma_max will be tested (Matlab notation).
-float TV_column_norm(float [],int,int,float);
+float MIRE_automatic_sigma(float [],const std::vector <float> &,int,int,int,
+                           int,float);
+/// Arguments : image, sorted columns, image size, sigma_min,simga_max,
+/// sigma_step: returns the sigma of MIRE_automatic without processing the
+/// image.
+void MIRE_search(float [],int, int,int,int,float,int);
+/// Arguments : image, image size, sigma_min,simga_max,sigma_step,row_step:
+//coarse-to-fine search of the best sigma of sigma_min:sigma_step:sigma_max,
+//the TV being evaluated on one line out of row_step.
+void MIRE_approximate(float [],int, int,int,int,float,int);
+/// Arguments : image, image size, sigma_min,simga_max,sigma_step, number of
+/// quantiles per column: MIRE_automatic on the quantiles of the columns.
+float *MIRE_quantiles(float [],const std::vector <float> &,float,int,int,int);
+/// Arguments : image, quantiles of the columns (see column_quantiles),
+/// std-dev of the gaussian, image size, number of quantiles per column.
+std::vector <int> quantile_pairs(float [],const std::vector <float> &,int,
+                                 int,int,std::vector <int> &);
+/// Arguments : image, quantiles of the columns, image size, number of
+/// quantiles per column, first pair of each column (output).
+/// Output : pairs of horizontal neighbors on the quantile grid.
+float TV_MIRE_quantiles(const std::vector <int> &,const std::vector <int> &,
+                        const std::vector <float> &,float,int,int);
+/// Arguments : pairs of neighbors and first pair of each column (see
+/// quantile_pairs), quantiles of the columns, std-dev of the gaussian,
+/// image width, number of quantiles per column.
+float MIRE_search_sigma(float [],const std::vector <float> &,int,int,int,int,
+                        float,int,int *);
+/// Arguments : image, sorted columns, image size, sigma_min,simga_max,
+/// sigma_step,row_step, number of evaluations (output): same search as
+/// MIRE_search, returns the best sigma without processing the image.
+std::vector <float> sigma_grid(int,int,float);
+/// Arguments : sigma_min,simga_max,sigma_step. Output : the sigmas
+/// sigma_min:sigma_step:sigma_max tested by the automatic modes.
+float TV_column_norm(float [],int,int);
 /// Arguments : image, image size.
+float TV_MIRE(float [],const std::vector <float> &,float,int,int,int);
+/// Arguments : image, sorted columns, std-dev of the gaussian, image size,
+/// row_step.
+float TV_MIRE_ranked(const std::vector <int> &,const std::vector <float> &,
+                     float,int,int);
+/// Arguments : ranks of the pixels (see column_ranks), sorted columns,
+/// std-dev of the gaussian, image size.
+void processed_column(float [],const std::vector <float> &,
+                      const std::vector <float> &,int,int,int,int,int,
+                      std::vector <float> &);
+/// Arguments : image, sorted columns, gaussian weights and radius, image size,
+/// column to be processed, row_step, output values.
 
-void specify_column(float [], int , int ,int , std::vector <float> );
+void specify_column(float [], int , int ,int , const float []);
 /// Arguements : imge, image size, column to be processed, target values.
 
 float gaussian(int ,float );
 /// Arguements : position (in pixel), std-dev.
 
-std::vector <std::vector<float> > target_histogram(
-    std::vector <std::vector<float> > ,int, int , float );
-/// Arguments : vector of vector containing the sorted values, image size,sigma.
+std::vector <float> gaussian_weights(float ,int );
+/// Arguements : std-dev, radius.
 
-std::vector <std::vector<float> >  column_sorting(float [],int ,int );
-/// Arguments : image, image size.
+int mirror_column(int ,int );
+/// Arguments : column index (possibly outside the image), image width.
+/// Output : index of the mirrored column.
+
+std::vector <float> target_histogram(const std::vector <float> &,int, int ,
+                                     float );
+/// Arguments : sorted columns (column-major), image size,sigma.
+void target_histogram(const std::vector <float> &,int, int ,float ,
+                      std::vector <float> &);
+/// Arguments : sorted columns, image size, sigma, output buffer.
+
+std::vector <float> column_sorting(float [],int ,int );
+/// Arguments : image, image size. Output : sorted columns (column-major).
+void column_sorting(float [],int ,int ,std::vector <float> &);
+/// Arguments : image, image size, output buffer.
+std::vector <int> column_ranks(float [],const std::vector <float> &,int ,int );
+/// Arguments : image, sorted columns, image size. Output : rank of each pixel
+/// in its sorted column.
 
 std::vector <float> histo_column(float [],int ,int , int );
 /// Arguments : image, image size, #column to be processed.
+
+std::vector <float> column_quantiles(float [],int ,int ,int );
+/// Arguments : image, image size, number of quantiles.
+/// Output : quantiles of the columns (column-major).
+
+float quantile_map(float ,const float [],const float [],int );
+/// Arguments : value, quantiles of its column, target quantiles, number of
+/// quantiles.
@@ -0,0 +1,364 @@
+/*
+* Copyright 2012 IPOL Image Processing On Line http://www.ipol.im/
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+* @file MIRE_stream.cpp
+* @brief MIRE on a video stream
+*
+* The columns artifacts of an infrared camera drift slowly, so the frames of
+* a video share the same correction. Instead of the sorted columns of one
+* frame, each column is summarized by Q quantiles, accumulated across the
+* frames with a forgetting factor alpha. The target quantiles are the
+* Gaussian-weighted midway of the neighbouring columns, as in MIRE, and each
+* pixel is mapped from the quantiles of its column to the target quantiles
+* (monotone piecewise linear map), so that a frame is corrected line by line
+* from the cached tables.
+*
+* The frames are not sorted: each pixel is located among the running
+* quantiles of its column (binary search among Q values), and the
+* distribution of the frame on that fixed grid is blended with the running
+* one (see blend_quantiles).
+*
+* sigma is estimated on the first frame with MIRE_search_sigma, and kept
+* until the residual column non-uniformity of a corrected frame
+* (column_residual) exceeds its running average by more than drift_th: the
+* quantiles are then reset, and sigma and the target quantiles are computed
+* again on the next frame.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include "MIRE.h"
+#include "MIRE_stream.h"
+
+/**
+* @fn void MIRE_stream_init(mire_stream *S, int w1, int h1, int Q,
+* float alpha, float drift_th, int SIGMA_MIN, int SIGMA_MAX, float DELTA,
+* int ROW_STEP)
+* @brief Initializes the state of a stream of frames of size w1 x h1.
+* @param S stream
+* @param w1 frame width
+* @param h1 frame height
+* @param Q number of quantiles per column (at least 2)
+* @param alpha weight of a new frame in the running quantiles, in ]0,1]
+* @param drift_th relative increase of the residual triggering a new
+* estimation of sigma
+* @param SIGMA_MIN
+* @param SIGMA_MAX
+* @param DELTA : step between two sigmas
+* @param ROW_STEP : one line out of ROW_STEP is used to evaluate the TV
+*/
+void MIRE_stream_init(mire_stream *S, int w1, int h1, int Q, float alpha,
+                      float drift_th, int SIGMA_MIN, int SIGMA_MAX,
+                      float DELTA, int ROW_STEP)
+{
+    S->w1=w1;
+    S->h1=h1;
+    S->Q=Q < 2 ? 2 : Q;
+    S->alpha=alpha;
+    S->drift_th=drift_th;
+    S->SIGMA_MIN=SIGMA_MIN;
+    S->SIGMA_MAX=SIGMA_MAX;
+    S->DELTA=DELTA;
+    S->ROW_STEP=ROW_STEP;
+    S->sigma_best=0;
+    S->residual_ref=0;
+    S->estimate=true;
+    S->n_frames=0;
+    S->n_estimations=0;
+    S->quantiles.assign(w1*S->Q,0);
+    S->targets.assign(w1*S->Q,0);
+}
+
+
+
+
+/**
+* @fn static void blend_quantiles(float *q, const int *bin,
+* const int *equal, float low, float high, int h1, int Q, float alpha)
+* @brief Blends the distribution of one column of a frame into its running
+* quantiles q, of levels k/(Q-1). The running distribution function is
+* piecewise linear between the quantiles. The one of the frame is known at
+* the quantiles from the counts of its pixels, with the rank convention of
+* column_quantiles: a quantile equal to pixels of the frame gets the middle
+* of their ranks, a run of equal quantiles spreads them. Both are blended
+* with weight alpha at the quantiles (and at the extreme values of the
+* frame, if outside), and the blended function is inverted at the levels
+* k/(Q-1) by linear interpolation.
+* @param q running quantiles of the column, updated
+* @param bin Q+1 counts: pixels strictly between q[k-1] and q[k]
+* @param equal Q counts: pixels equal to q[k] (counted at the last quantile
+* of a run of equal quantiles)
+* @param low minimal value of the column of the frame
+* @param high maximal value of the column of the frame
+* @param h1 frame height
+* @param Q number of quantiles
+* @param alpha weight of the frame
+*/
+static void blend_quantiles(float *q, const int *bin, const int *equal,
+                            float low, float high, int h1, int Q, float alpha)
+{
+    const float n= h1>1 ? h1-1 : 1; // rank of the largest pixel
+    std::vector <float> x;  // grid: the running quantiles, extended
+    std::vector <float> F;  // blended distribution function on the grid
+    x.reserve(Q+2);
+    F.reserve(Q+2);
+
+    if (low<q[0])
+    {
+        x.push_back(low);
+        F.push_back(0);
+    }
+    int below=bin[0]; // pixels below the current quantile
+    for (int a=0;a<Q;)
+    {
+//[a,b] is a run of equal quantiles
+        int b=a;
+        while (b+1<Q && q[b+1]==q[a])
+            b++;
+        int eq=equal[b];
+        for (int k=a;k<=b;k++)
+        {
+            float rank= eq==0 ? below-0.5f
+                        : below+(eq-1)*(b>a ? (float) (k-a)/(b-a) : 0.5f);
+            float frame=rank/n;
+            if (frame<0) frame=0;
+            if (frame>1) frame=1;
+            x.push_back(q[k]);
+            F.push_back((1-alpha)*k/(Q-1)+alpha*frame);
+        }
+        below=below+eq+bin[b+1];
+        a=b+1;
+    }
+    if (high>q[Q-1])
+    {
+        x.push_back(high);
+        F.push_back(1);
+    }
+
+//inversion: F is non-decreasing, and so are the levels
+    int j=0;
+    for (int k=0;k<Q;k++)
+    {
+        float level=(float) k/(Q-1);
+        while (j<(int) F.size() && F[j]<level)
+            j++;
+        if (j==0)
+            q[k]=x[0];
+        else if (j==(int) F.size())
+            q[k]=x.back();
+        else
+        {
+            float t=(level-F[j-1])/(F[j]-F[j-1]);
+            q[k]=x[j-1]+t*(x[j]-x[j-1]);
+        }
+    }
+}
+
+
+
+
+/**
+* @fn static void update_quantiles(mire_stream *S, float *FRAME)
+* @brief Accumulates the frame in the running quantiles, without sorting:
+* the pixels are counted between the running quantiles of their column,
+* by blocks of columns, then each column is blended (see blend_quantiles).
+* The first frame and the frames where sigma is estimated again (the columns
+* drifted) reset them to the quantiles of the frame (see column_quantiles).
+*/
+static void update_quantiles(mire_stream *S, float *FRAME)
+{
+    const int w1=S->w1, h1=S->h1, Q=S->Q;
+
+    if (S->estimate)
+    {
+        S->quantiles=column_quantiles(FRAME,w1,h1,Q);
+        return;
+    }
+
+    const int B=16; // columns per block: their quantiles and counts stay
+                    // in cache while the lines are read
+    int span=1;     // largest power of 2 not above Q
+    while (2*span<=Q)
+        span=2*span;
+#pragma omp parallel for schedule(dynamic)
+    for (int c0=0;c0<w1;c0+=B)
+    {
+        const int c1= c0+B<w1 ? c0+B : w1;
+        std::vector <int> bin((c1-c0)*(Q+1),0);
+        std::vector <int> equal((c1-c0)*Q,0);
+        std::vector <float> low(FRAME+c0,FRAME+c1);
+        std::vector <float> high(FRAME+c0,FRAME+c1);
+        for (int line=0;line<h1;line++)
+        {
+            for (int c=c0;c<c1;c++)
+            {
+                const float value=FRAME[line*w1+c];
+                const float *q=&S->quantiles[c*Q];
+// q[k-1] <= value < q[k]: binary search without branches, the pixels
+// of a column being in no particular order
+                int k=0;
+                for (int step=span;step>0;step=step/2)
+                    k= (k+step<=Q && q[k+step-1]<=value) ? k+step : k;
+                if (k>0 && value==q[k-1])
+                    equal[(c-c0)*Q+k-1]++;
+                else
+                    bin[(c-c0)*(Q+1)+k]++;
+                if (value<low[c-c0]) low[c-c0]=value;
+                if (value>high[c-c0]) high[c-c0]=value;
+            }
+        }
+        for (int c=c0;c<c1;c++)
+            blend_quantiles(&S->quantiles[c*Q],&bin[(c-c0)*(Q+1)],
+                            &equal[(c-c0)*Q],low[c-c0],high[c-c0],h1,Q,
+                            S->alpha);
+    }
+}
+
+
+
+
+/**
+* @fn static void update_targets(mire_stream *S)
+* @brief Target quantiles of each column: Gaussian-weighted average of the
+* quantiles of the neighbouring columns (see target_histogram). Computed
+* when sigma is estimated only: between two estimations the running
+* quantiles follow the slow drift of the columns, and the targets are kept.
+*/
+static void update_targets(mire_stream *S)
+{
+    if (S->sigma_best==0)
+        S->targets=S->quantiles;
+    else
+        S->targets=target_histogram(S->quantiles,S->w1,S->Q,S->sigma_best);
+}
+
+
+
+
+/**
+* @fn void MIRE_stream_line(const mire_stream *S, float *LINE)
+* @brief Corrects one line of a frame with the cached tables: each pixel is
+* mapped from the quantiles of its column to the target quantiles (see
+* quantile_map).
+* @param S stream
+* @param LINE line of w1 pixels, corrected in place
+*/
+void MIRE_stream_line(const mire_stream *S, float *LINE)
+{
+    const int Q=S->Q;
+
+    for (int c=0;c<S->w1;c++)
+        LINE[c]=quantile_map(LINE[c],&S->quantiles[c*Q],&S->targets[c*Q],Q);
+}
+
+
+
+
+/**
+* @fn float column_residual(float *IMAGE, int w1, int h1)
+* @brief Residual column non-uniformity: mean absolute difference between
+* the means of two adjacent columns.
+* @param IMAGE input
+* @param w1 image width
+* @param h1 image height
+* @return residual
+*/
+float column_residual(float *IMAGE, int w1, int h1)
+{
+    if (w1<2 || h1<1) return 0;
+
+    std::vector <double> mean(w1,0);
+    for (int line=0;line<h1;line++)
+        for (int c=0;c<w1;c++)
+            mean[c]+=IMAGE[line*w1+c];
+
+    double residual=0;
+    for (int c=0;c<w1-1;c++)
+        residual+=fabs(mean[c+1]-mean[c]);
+    return (float) (residual/((double) h1*(w1-1)));
+}
+
+
+
+
+/**
+* @fn static void estimate_sigma(mire_stream *S, float *FRAME)
+* @brief Estimates sigma on one frame with MIRE_search_sigma.
+*/
+static void estimate_sigma(mire_stream *S, float *FRAME)
+{
+    const int w1=S->w1, h1=S->h1;
+
+    S->sigma_best=MIRE_search_sigma(FRAME,column_sorting(FRAME,w1,h1),w1,h1,
+                                    S->SIGMA_MIN,S->SIGMA_MAX,S->DELTA,
+                                    S->ROW_STEP,NULL);
+    S->n_estimations++;
+}
+
+
+
+
+/**
+* @fn bool MIRE_stream_frame(mire_stream *S, float *FRAME)
+* @brief Processes one frame of the stream: accumulates its quantiles,
+* estimates sigma and the target quantiles if needed, corrects the frame and
+* runs the drift test.
+* @param S stream
+* @param FRAME frame of size w1 x h1, corrected in place
+* @return true if sigma was estimated on this frame
+*/
+bool MIRE_stream_frame(mire_stream *S, float *FRAME)
+{
+    const int w1=S->w1, h1=S->h1;
+    bool estimated=false;
+
+    update_quantiles(S,FRAME);
+    if (S->estimate)
+    {
+        estimate_sigma(S,FRAME);
+        update_targets(S);
+        estimated=true;
+    }
+
+#pragma omp parallel for
+    for (int line=0;line<h1;line++)
+        MIRE_stream_line(S,&FRAME[line*w1]);
+
+// drift test: sigma is estimated again on the next frame when the residual
+// jumps by more than drift_th above its running average; slow drifts are
+// followed by the running quantiles and the average. The frame where sigma
+// was estimated is corrected from its own quantiles only, and its residual
+// is too low to be the reference: the next frame gives it.
+    float residual=column_residual(FRAME,w1,h1);
+    if (estimated)
+    {
+        S->residual_ref=-1;
+        S->estimate=false;
+    }
+    else if (S->residual_ref<0)
+        S->residual_ref=residual;
+    else if (residual>(1+S->drift_th)*S->residual_ref)
+        S->estimate=true;
+    else
+        S->residual_ref=(1-S->alpha)*S->residual_ref+S->alpha*residual;
+
+    S->n_frames++;
+    return estimated;
+}
@@ -0,0 +1,56 @@
+/*  MIRE_stream.h */
+/*
+* Copyright 2012 IPOL Image Processing On Line http://www.ipol.im/
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <vector>
+
+/**
+* @brief State of MIRE on a video stream, see MIRE_stream.cpp.
+*/
+struct mire_stream
+{
+    int w1,h1;                  // frame size
+    int Q;                      // number of quantiles per column
+    float alpha;                // weight of a new frame in the quantiles
+    float drift_th;             // relative increase of the residual that
+                                // triggers a new estimation of sigma
+    int SIGMA_MIN,SIGMA_MAX;    // range of the sigma search
+    float DELTA;                // step of the sigma search
+    int ROW_STEP;               // line subsampling of the sigma search
+    float sigma_best;           // current sigma
+    float residual_ref;         // running average of the residual
+    bool estimate;              // sigma must be estimated on the next frame
+    int n_frames;               // number of processed frames
+    int n_estimations;          // number of estimations of sigma
+    std::vector <float> quantiles; // running quantiles, column-major w1*Q
+    std::vector <float> targets;   // target quantiles, column-major w1*Q
+};
+
+void MIRE_stream_init(mire_stream *,int,int,int,float,float,int,int,float,int);
+/// Arguments : stream, frame size, number of quantiles, alpha, drift_th,
+/// sigma_min, sigma_max, sigma_step, row_step.
+
+bool MIRE_stream_frame(mire_stream *,float []);
+/// Arguments : stream, frame (corrected in place).
+/// Output : true if sigma was estimated again on this frame.
+
+void MIRE_stream_line(const mire_stream *,float []);
+/// Arguments : stream, one line of a frame (corrected in place).
+
+float column_residual(float [],int,int);
+/// Arguments : frame, frame size.
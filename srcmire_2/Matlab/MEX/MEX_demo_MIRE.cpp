@@ -7,7 +7,6 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "../../MIRE.h"
-#include "../../borders.h"
 
 
 void mexFunction (int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
@@ -54,55 +53,15 @@ void mexFunction (int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
 	 	   Image[tmpx+tmpy*w1] = (float)(mxGetPr(prhs[0]))[tmpy+tmpx*h1];
 
 
-////////////////////////////////////////////////////////////////////////////////
-//////////////DEALING WITH BORDER EFFECTS: MIRROR symmetry ON COLUMNS////////////
-////////////////////////////////////////////////////////////////////////////////
-
-
-
-
-    int W=w1+8*SIGMA_MAX;
-//new  width of image afer mirror symmetry : 4 times SIGMA_MAX on each sides
-    float* Imsym= new float[W*h1]; //new image allocation
-
-//input : image, New image, width,height, total size of the extension
-    borders(Image,Imsym,w1,h1,4*SIGMA_MAX); //Output :
-//Classic mirror symmetry on columns :
-//    C1 C2 ... CN => C2 C1 |C1 C2 ... CN|CN CN-1 etc
-
-
-
-
-
 ////////////////////////////////////////////////////////////////////////////////
 //////////////////////////TRANSFERING DATAS TO CENTRAL FUNCTION/////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
-//input image , width (after symetrication), height
-    MIRE_automatic(Imsym,W,h1,SIGMA_MIN, SIGMA_MAX, DELTA);
-
-
-
-
-////////////////////////////////////////////////////////////////////////////////
-///////////REMOVING THE SYMETRIZATION : CROP (see DEALING WITH BORDERS//////////
-////////////////////////////////////////////////////////////////////////////////
-
-
-
-//#pragma omp parallel for
-// The following realize a CROP
-    for (unsigned column=0;column<w1;column++)  // for all columns
-    {
-        for (unsigned line=0;line<h1;line++)  // for all lines
-        {
-            Image[line*w1+column]
-            =Imsym[line*(w1+8*SIGMA_MAX)+column+4*SIGMA_MAX];
-// using the useless memory of the input
-        }
-    }
+//input image , width, height. Border effects are dealt with by MIRE, the
+//columns beyond the borders being indexed by mirror symmetry :
+//    C1 C2 ... CN => C2 C1 |C1 C2 ... CN|CN CN-1 etc
+    MIRE_automatic(Image,w1,h1,SIGMA_MIN, SIGMA_MAX, DELTA);
 
-    delete [] Imsym;
 
 
 ////////////////////////////////////////////////////////////////////////////////
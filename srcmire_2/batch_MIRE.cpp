@@ -0,0 +1,304 @@
+/*
+* Copyright 2012 IPOL Image Processing On Line http://www.ipol.im/
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+* @file batch_MIRE.cpp
+* @brief Columns-artifacts removal on a list of frames
+*
+* The input is a manifest: a text file with the name of one 8bits png frame
+* per line. Each frame is processed as by demo_MIRE and written, with the
+* same name, in the output directory.
+*
+* With OpenMP (`make OMP=1`) the frames are processed by a pool of worker
+* threads. Each worker takes the next frame of the manifest, decodes it,
+* processes it and encodes it, so the png input/output of a frame overlaps
+* the processing of the other frames. Each worker owns its buffers (sorted
+* columns and target values), reused from one frame to the next. The
+* manifest is read before any frame is processed, and rejected when two
+* frames would be written to the same output file.
+*
+* For each frame the input, the output and the chosen sigma are printed.
+* At the end, the number of frames per second and the time spent in each
+* stage (summed over the workers) are printed.
+*/
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "io_png/io_png.h"
+#include "MIRE.h"
+
+/**
+* @fn static double wall_time()
+* @brief Current time in seconds.
+*/
+static double wall_time()
+{
+    struct timeval t;
+    gettimeofday(&t,NULL);
+    return t.tv_sec+1e-6*t.tv_usec;
+}
+
+/**
+* @fn static std::vector <std::string> read_manifest(FILE *manifest)
+* @brief Reads the names of the frames of the manifest, skipping the empty
+* lines.
+*/
+static std::vector <std::string> read_manifest(FILE *manifest)
+{
+    std::vector <std::string> names;
+    char line[4096];
+    while (fgets(line,sizeof(line),manifest)!=NULL)
+    {
+        size_t n=strlen(line);
+        while (n>0 && (line[n-1]=='\n' || line[n-1]=='\r' || line[n-1]==' '))
+            line[--n]='\0';
+        if (n>0) names.push_back(line);
+    }
+    return names;
+}
+
+/**
+* @fn static std::string output_name(const std::string &dir,
+* const std::string &name)
+* @brief Name of the output frame: the file name of the input frame in the
+* output directory.
+*/
+static std::string output_name(const std::string &dir, const std::string &name)
+{
+    size_t slash=name.find_last_of('/');
+    return dir+"/"+(slash==std::string::npos ? name : name.substr(slash+1));
+}
+
+/**
+* @fn static int output_collisions(const std::vector <std::string> &names,
+* const std::vector <std::string> &outs)
+* @brief Reports the frames written to the same output file (same file name
+* in different directories), which two workers would write at once.
+* @return number of collisions
+*/
+static int output_collisions(const std::vector <std::string> &names,
+                             const std::vector <std::string> &outs)
+{
+// equal output names are consecutive once sorted
+    std::vector <std::pair <std::string,size_t> > sorted;
+    for (size_t i=0;i<outs.size();i++)
+        sorted.push_back(std::make_pair(outs[i],i));
+    std::sort(sorted.begin(),sorted.end());
+
+    int collisions=0;
+    for (size_t i=1;i<sorted.size();i++)
+        if (sorted[i].first==sorted[i-1].first)
+        {
+            std::cerr << names[sorted[i-1].second] << " and "
+            << names[sorted[i].second] << " would both be written to "
+            << sorted[i].first << std::endl;
+            collisions++;
+        }
+    return collisions;
+}
+
+/**
+* @fn main(int argc, char **argv)
+* @brief main function
+* @param argc
+* @param **argv : manifest, output directory. Optional : -t THREADS number
+* of worker threads, -f [ROW_STEP] coarse-to-fine search of sigma (see
+* demo_MIRE).
+*/
+int main(int argc, char **argv)
+{
+//Check arguments : MANIFEST OUT_DIR [-t THREADS] [-f [ROW_STEP]]
+    bool search=false; // coarse-to-fine search of sigma
+    int ROW_STEP=1; // lines subsampling of the TV during the search
+    int threads=0; // number of workers, 0: OpenMP default
+    bool valid=(argc>=3);
+    for (int i=3;i<argc && valid;i++)
+    {
+        std::string option(argv[i]);
+        if (option=="-t" && i+1<argc)
+            threads=atoi(argv[++i]);
+        else if (option=="-f")
+        {
+            search=true;
+            if (i+1<argc && argv[i+1][0]!='-') ROW_STEP=atoi(argv[++i]);
+        }
+        else
+            valid=false;
+    }
+    if (!valid || ROW_STEP<1 || threads<0)
+    {
+        std::cerr << " **************************************** " << std::endl
+        << " **********  MIRE batch  ************************** " << std::endl
+        << " ************************************************** " << std::endl
+        << "Usage: " << argv[0] << " manifest.txt OUT_DIR "
+        << "[-t THREADS] [-f [ROW_STEP]]" << std::endl
+        << "Input" << std::endl
+        << "manifest.txt: one frame per line, gray (1 channel),  PNG. "
+        << std::endl
+        << "Output" << std::endl
+        << "OUT_DIR: directory of the denoised frames, same names. "
+        << std::endl
+        << "Options" << std::endl
+        << "-t: number of worker threads (with OpenMP)." << std::endl
+        << "-f: fast coarse-to-fine search of sigma, the TV being "
+        << "evaluated on one line out of ROW_STEP (default 1)." << std::endl
+        << " ************************************************** " << std::endl;
+        return 1;
+    }
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////// CONSTANT PARAMETER DEFINITION////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+    const int SIGMA_MIN=0; // minimal std-dev of the Gaussian-weighting function
+    const int SIGMA_MAX=8; //maximal std-dev of the Gaussian-weighting function
+    const float DELTA=0.5; //step between two consecutive std-dev
+
+    FILE *manifest=fopen(argv[1],"r");
+    if (manifest==NULL)
+    {
+        std::cerr << "Unable to open manifest " << argv[1] << std::endl;
+        return 1;
+    }
+    std::vector <std::string> names=read_manifest(manifest);
+    fclose(manifest);
+
+// output names, checked before any frame is written
+    std::string out_dir(argv[2]);
+    std::vector <std::string> outs;
+    for (size_t i=0;i<names.size();i++)
+        outs.push_back(output_name(out_dir,names[i]));
+    if (output_collisions(names,outs)>0)
+    {
+        std::cerr << "Frames of the manifest with the same output name"
+        << std::endl;
+        return 1;
+    }
+    const int nframes=(int) names.size();
+
+// the frames are processed in parallel, each one by a single thread (the
+// parallel loops of MIRE are not nested)
+#ifdef _OPENMP
+    if (threads>0) omp_set_num_threads(threads);
+#else
+    if (threads>1)
+        std::cerr << "Compiled without OpenMP: one worker" << std::endl;
+#endif
+
+    int frames=0, failures=0;
+// time of each stage, summed over the workers
+    double t_decode=0, t_sort=0, t_sigma=0, t_apply=0, t_encode=0;
+    double start=wall_time();
+
+#pragma omp parallel reduction(+:frames,failures,t_decode,t_sort,t_sigma,\
+                               t_apply,t_encode)
+    {
+// buffers of the worker, reused from one frame to the next
+        std::vector <float> c_sorted;
+        std::vector <float> targets;
+
+// each worker takes the next frame of the manifest
+#pragma omp for schedule(dynamic,1)
+        for (int k=0;k<nframes;k++)
+        {
+            const std::string &name=names[k];
+            const std::string &out=outs[k];
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////// READ FRAME///////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+            double t0=wall_time();
+            float * Image;  //frame
+            size_t w1, h1; // width an height of the frame
+            if (NULL == (Image = read_png_f32_gray(name.c_str(), &w1, &h1)))
+            {
+#pragma omp critical (output)
+                std::cerr << "Unable to load  file " << name << std::endl;
+                failures++;
+                continue;
+            }
+            double t1=wall_time();
+
+////////////////////////////////////////////////////////////////////////////////
+//////////////////////////PROCESSING THE FRAME//////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+            column_sorting(Image,w1,h1,c_sorted);
+            double t2=wall_time();
+            float sigma_best= search
+                ? MIRE_search_sigma(Image,c_sorted,w1,h1,SIGMA_MIN,SIGMA_MAX,
+                                    DELTA,ROW_STEP,NULL)
+                : MIRE_automatic_sigma(Image,c_sorted,w1,h1,SIGMA_MIN,
+                                       SIGMA_MAX,DELTA);
+            double t3=wall_time();
+            if (sigma_best!=0)
+                MIRE_sorted(Image,c_sorted,sigma_best,w1,h1,targets);
+
+//Imposing [0,255] as demo_MIRE
+            float min=Image[0];
+            float max=Image[0];
+            for (size_t i=1;i<w1*h1;i++)
+            {
+                if (Image[i]<min) min=Image[i];
+                if (Image[i]>max) max=Image[i];
+            }
+            for (size_t i=0;i<w1*h1;i++)
+                Image[i]=(255*(Image[i]-min)/(max-min));
+            double t4=wall_time();
+
+////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////WRITING THE OUTPUT////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+            int status=write_png_f32(out.c_str(),Image,w1,h1,1);
+            free(Image);
+            double t5=wall_time();
+
+#pragma omp critical (output)
+            {
+                if (status!=0)
+                    std::cerr << "Unable to write file " << out << std::endl;
+                else
+                    printf("%s %s SIGMA_BEST: %f\n",name.c_str(),out.c_str(),
+                           sigma_best);
+            }
+            if (status!=0) failures++;
+            else frames++;
+
+            t_decode+=t1-t0;
+            t_sort+=t2-t1;
+            t_sigma+=t3-t2;
+            t_apply+=t4-t3;
+            t_encode+=t5-t4;
+        }
+    }
+    double elapsed=wall_time()-start;
+
+    printf("FRAMES: %d (%d failed) in %.3f s, %.2f frames/s\n",frames,failures,
+           elapsed,elapsed>0 ? frames/elapsed : 0.0);
+    printf("STAGES (s, summed over the workers): decode %.3f, sort %.3f, "
+           "sigma %.3f, apply %.3f, encode %.3f\n",t_decode,t_sort,t_sigma,
+           t_apply,t_encode);
+
+    return failures>0 ? 1 : 0;
+}
@@ -0,0 +1,222 @@
+/*
+* Copyright 2012 IPOL Image Processing On Line http://www.ipol.im/
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+* @file bench_MIRE.cpp
+* @brief Benchmark of the column specification of MIRE
+*
+* Times specify_column on synthetic images of heights 256 to 4096 and
+* compares it with the reference O(h^2) implementation (linear scan of the
+* sorted column for each pixel): the run time and whether both give the
+* same image.
+*
+* Then times the evaluation of one sigma candidate of MIRE_automatic, on a
+* processed copy of the image (MIRE_sorted then TV_column_norm) or without
+* processing the image (TV_MIRE_ranked, the ranks of the pixels being
+* computed once for all the candidates by column_ranks), and checks that
+* both TV are equal.
+*
+* Finally reports the error of the approximate mode (MIRE_quantiles, Q
+* quantiles per column) against the exact mode (MIRE) on tall synthetic
+* images, with the run times and the number of values stored per column,
+* and times the sigma sweep of MIRE_approximate: the pairs of neighbors
+* counted once on the quantile grid (quantile_pairs), then the TV of each
+* sigma of 0:0.5:8 (TV_MIRE_quantiles).
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <ctime>
+#include <vector>
+#include <algorithm>
+#include "MIRE.h"
+#include "synthetic.h"
+
+/**
+* @fn void specify_column_reference(float *IMAGE, int w1, int h1,
+* int column_current, const float *target_values)
+* @brief Reference column specification: for each pixel, linear scan of the
+* sorted column to find its rank. O(h1^2) per column.
+*/
+static void specify_column_reference(float *IMAGE, int w1, int h1,
+                                     int column_current,
+                                     const float *target_values)
+{
+    std::vector <float> column_sorted;
+    for (int i=0;i<h1;i++)
+        column_sorted.push_back(IMAGE[i*w1+column_current]);
+    std::sort (column_sorted.begin(), column_sorted.end());
+
+    for (int i=0;i<h1;i++)
+    {
+        float temp= IMAGE[i*w1+column_current] ;
+        for (int j=0;j<h1;j++)
+        {
+            if (temp==column_sorted[j])
+            {
+                IMAGE[i*w1+column_current]=target_values[j];
+            }
+        }
+    }
+}
+
+/**
+* @fn int main()
+* @brief Runs the benchmark and prints a table: image height, time of the
+* rank-based and of the reference column specification in milliseconds for
+* all the columns, speedup, and whether the results are identical.
+*/
+int main()
+{
+    const int w1=64;  // number of columns of the synthetic images
+    const float AMPLITUDE=16; // amplitude of their stripes
+    srand(1);
+
+    printf("%6s %12s %14s %9s %10s\n",
+           "height","rank (ms)","reference (ms)","speedup","identical");
+    for (int h1=256;h1<=4096;h1*=2)
+    {
+        float *IMAGE=new float[w1*h1];
+        float *Imref=new float[w1*h1];
+        striped_image(IMAGE,w1,h1,AMPLITUDE);
+        for (int i=0;i<w1*h1;i++)
+            Imref[i]=IMAGE[i];
+
+// target values: the midway histogram of the columns, as in MIRE
+        std::vector <float> v;
+        v=target_histogram(column_sorting(IMAGE,w1,h1),w1,h1,1);
+
+        clock_t start=clock();
+        for (int column=0;column<w1;column++)
+            specify_column(IMAGE,w1,h1,column,&v[column*h1]);
+        double t_rank=1000.0*(clock()-start)/CLOCKS_PER_SEC;
+
+        start=clock();
+        for (int column=0;column<w1;column++)
+            specify_column_reference(Imref,w1,h1,column,&v[column*h1]);
+        double t_ref=1000.0*(clock()-start)/CLOCKS_PER_SEC;
+
+        bool identical=true;
+        for (int i=0;i<w1*h1;i++)
+            if (IMAGE[i]!=Imref[i]) identical=false;
+
+        printf("%6d %12.2f %14.2f %9.1f %10s\n",h1,t_rank,t_ref,
+               t_rank>0 ? t_ref/t_rank : 0.0,identical ? "yes" : "NO");
+
+        delete [] IMAGE;
+        delete [] Imref;
+    }
+
+// cost of one sigma candidate: processed copy or TV_MIRE
+    const int w2=256;     // width of the images
+    const int REPEAT=10;  // candidates evaluated for each timing
+    printf("\none sigma candidate (sigma 2), width %d\n",w2);
+    printf("%6s %15s %12s %11s %9s %10s\n","height","processed (ms)",
+           "ranks (ms)","ranked (ms)","speedup","same TV");
+    for (int h1=256;h1<=2048;h1*=2)
+    {
+        float *IMAGE=new float[w2*h1];
+        float *Imtemp=new float[w2*h1];
+        striped_image(IMAGE,w2,h1,AMPLITUDE);
+        std::vector <float> c_sorted=column_sorting(IMAGE,w2,h1);
+        std::vector <float> v;
+        float TV_processed=0, TV_image_free=0;
+
+        clock_t start=clock();
+        for (int r=0;r<REPEAT;r++)
+        {
+            for (int i=0;i<w2*h1;i++)
+                Imtemp[i]=IMAGE[i];
+            MIRE_sorted(Imtemp,c_sorted,2,w2,h1,v);
+            TV_processed=TV_column_norm(Imtemp,w2,h1);
+        }
+        double t_processed=1000.0*(clock()-start)/CLOCKS_PER_SEC/REPEAT;
+
+        start=clock();
+        std::vector <int> rank=column_ranks(IMAGE,c_sorted,w2,h1);
+        double t_ranks=1000.0*(clock()-start)/CLOCKS_PER_SEC;
+
+        start=clock();
+        for (int r=0;r<REPEAT;r++)
+            TV_image_free=TV_MIRE_ranked(rank,c_sorted,2,w2,h1);
+        double t_image_free=1000.0*(clock()-start)/CLOCKS_PER_SEC/REPEAT;
+
+        printf("%6d %15.2f %12.2f %11.2f %9.2f %10s\n",h1,t_processed,t_ranks,
+               t_image_free,
+               t_image_free>0 ? t_processed/t_image_free : 0.0,
+               TV_processed==TV_image_free ? "yes" : "NO");
+
+        delete [] IMAGE;
+        delete [] Imtemp;
+    }
+
+// error report of the approximate mode against the exact mode
+    const int Q=256;     // quantiles per column
+    const float sigma=2; // std-dev of the Gaussian
+    printf("\napproximate mode, %d quantiles per column, sigma %g\n",Q,sigma);
+    printf("%6s %11s %12s %13s %10s %10s %11s %12s\n","height","exact (ms)",
+           "approx (ms)","values/column","max error","mean error",
+           "pairs (ms)","sweep (ms)");
+    for (int h1=1024;h1<=65536;h1*=4)
+    {
+        float *IMAGE=new float[w1*h1];
+        float *Imapprox=new float[w1*h1];
+        float *Imsweep=new float[w1*h1];
+        striped_image(IMAGE,w1,h1,AMPLITUDE);
+        for (int i=0;i<w1*h1;i++)
+            Imapprox[i]=Imsweep[i]=IMAGE[i];
+
+        clock_t start=clock();
+        MIRE(IMAGE,sigma,w1,h1);
+        double t_exact=1000.0*(clock()-start)/CLOCKS_PER_SEC;
+
+        start=clock();
+        std::vector <float> quantiles=column_quantiles(Imapprox,w1,h1,Q);
+        MIRE_quantiles(Imapprox,quantiles,sigma,w1,h1,Q);
+        double t_approx=1000.0*(clock()-start)/CLOCKS_PER_SEC;
+
+// the sigma sweep, on the unprocessed image
+        start=clock();
+        std::vector <int> first;
+        std::vector <int> pairs=quantile_pairs(Imsweep,quantiles,w1,h1,Q,
+                                               first);
+        double t_pairs=1000.0*(clock()-start)/CLOCKS_PER_SEC;
+
+        start=clock();
+        std::vector <float> sigmas=sigma_grid(0,8,0.5);
+        for (int i=0;i<(int) sigmas.size();i++)
+            TV_MIRE_quantiles(pairs,first,quantiles,sigmas[i],w1,Q);
+        double t_sweep=1000.0*(clock()-start)/CLOCKS_PER_SEC;
+
+        double max_error=0, mean_error=0;
+        for (int i=0;i<w1*h1;i++)
+        {
+            double error=fabs(IMAGE[i]-Imapprox[i]);
+            if (error>max_error) max_error=error;
+            mean_error+=error;
+        }
+        mean_error/=(double) w1*h1;
+
+        printf("%6d %11.2f %12.2f %6d/%-6d %10.4f %10.4f %11.2f %12.2f\n",h1,
+               t_exact,t_approx,Q,h1,max_error,mean_error,t_pairs,t_sweep);
+
+        delete [] IMAGE;
+        delete [] Imapprox;
+        delete [] Imsweep;
+    }
+    return 0;
+}
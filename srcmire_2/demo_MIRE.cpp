@@ -38,31 +38,55 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <iostream>
+#include <string>
 #include "io_png/io_png.h"
 #include "MIRE.h"
-#include "borders.h"
 
 /**
 * @fn main(int argc, char **argv)
 * @brief main function
 * @param argc
 * @param **argv : ImNoisy  Noisy (corrupted), gray-level (1 channel) PNG image.
-* ImDenoised denoised  PNG image.
+* ImDenoised denoised  PNG image. Optional : -f [ROW_STEP] searches the best
+* sigma with the coarse-to-fine optimizer (MIRE_search) instead of testing
+* every sigma, evaluating the TV on one line out of ROW_STEP (default 1).
+* Or -q [Q] runs the approximate mode (MIRE_approximate), each column being
+* represented by Q quantiles (default 256).
 *
 */
 int main(int argc, char **argv)
 {
-//Check arguments : IN OUT;
-    if (argc != 3)
+//Check arguments : IN OUT [-f [ROW_STEP] | -q [Q]];
+    bool search=false; // coarse-to-fine search of sigma
+    int ROW_STEP=1; // lines subsampling of the TV during the search
+    bool approximate=false; // quantiles of the columns instead of the columns
+    int Q=256; // quantiles per column in the approximate mode
+    if (argc >= 4 && argc <= 5 && std::string(argv[3]) == "-f")
+    {
+        search=true;
+        if (argc == 5) ROW_STEP=atoi(argv[4]);
+    }
+    if (argc >= 4 && argc <= 5 && std::string(argv[3]) == "-q")
+    {
+        approximate=true;
+        if (argc == 5) Q=atoi(argv[4]);
+    }
+    if ((argc != 3 && !search && !approximate) || ROW_STEP < 1 || Q < 2)
     {
         std::cerr << " **************************************** " << std::endl
         << " **********  MIRE  ******************************** " << std::endl
         << " ************************************************** " << std::endl
-        << "Usage: " << argv[0] << " ImNoisy.png ImDenoised.png " << std::endl
+        << "Usage: " << argv[0] << " ImNoisy.png ImDenoised.png "
+        << "[-f [ROW_STEP] | -q [Q]]" << std::endl
         << "Input" << std::endl
         << "ImNoisy: columns artifacts, gray (1 channel),  PNG. " << std::endl
         << "Output" << std::endl
         << "ImDenoised: denoised  in PNG. " << std::endl
+        << "Options" << std::endl
+        << "-f: fast coarse-to-fine search of sigma, the TV being "
+        << "evaluated on one line out of ROW_STEP (default 1)." << std::endl
+        << "-q: approximate mode for tall images, each column being "
+        << "represented by Q quantiles (default 256)." << std::endl
         << " ************************************************** " << std::endl
         << "****************  Yohann Tendero, 2011  *********** " << std::endl
         << " ************************************************** " << std::endl;
@@ -97,55 +121,19 @@ int main(int argc, char **argv)
 
 
 
-////////////////////////////////////////////////////////////////////////////////
-//////////////DEALING WITH BORDER EFFECTS: MIRROR symmetry ON COLUMNS////////////
-////////////////////////////////////////////////////////////////////////////////
-
-
-
-
-    int W=w1+8*SIGMA_MAX;
-//new  width of image afer mirror symmetry : 4 times SIGMA_MAX on each sides
-    float* Imsym= new float[W*h1]; //new image allocation
-
-//input : image, New image, width,height, total size of the extension
-    borders(Image,Imsym,w1,h1,4*SIGMA_MAX); //Output :
-//Classic mirror symmetry on columns :
-//    C1 C2 ... CN => C2 C1 |C1 C2 ... CN|CN CN-1 etc
-
-
-
-
-
 ////////////////////////////////////////////////////////////////////////////////
 //////////////////////////TRANSFERING DATAS TO CENTRAL FUNCTION/////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
-//input image , width (after symetrication), height
-    MIRE_automatic(Imsym,W,h1,SIGMA_MIN, SIGMA_MAX, DELTA);
-
-
-
-
-////////////////////////////////////////////////////////////////////////////////
-///////////REMOVING THE SYMETRIZATION : CROP (see DEALING WITH BORDERS//////////
-////////////////////////////////////////////////////////////////////////////////
-
-
-
-//#pragma omp parallel for
-// The following realize a CROP
-    for (unsigned column=0;column<w1;column++)  // for all columns
-    {
-        for (unsigned line=0;line<h1;line++)  // for all lines
-        {
-            Image[line*w1+column]
-            =Imsym[line*(w1+8*SIGMA_MAX)+column+4*SIGMA_MAX];
-// using the useless memory of the input
-        }
-    }
-
-    delete [] Imsym;
+//input image , width, height. Border effects are dealt with by MIRE, the
+//columns beyond the borders being indexed by mirror symmetry :
+//    C1 C2 ... CN => C2 C1 |C1 C2 ... CN|CN CN-1 etc
+    if (search)
+        MIRE_search(Image,w1,h1,SIGMA_MIN, SIGMA_MAX, DELTA, ROW_STEP);
+    else if (approximate)
+        MIRE_approximate(Image,w1,h1,SIGMA_MIN, SIGMA_MAX, DELTA, Q);
+    else
+        MIRE_automatic(Image,w1,h1,SIGMA_MIN, SIGMA_MAX, DELTA);
 
 
 
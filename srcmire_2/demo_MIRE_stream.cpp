@@ -0,0 +1,143 @@
+/*
+* Copyright 2012 IPOL Image Processing On Line http://www.ipol.im/
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+* @file demo_MIRE_stream.cpp
+* @brief Columns-artifacts removal on a sequence of frames
+*
+* The inputs are 8bits png frames of the same size, processed in order by
+* MIRE_stream (see MIRE_stream.cpp). The outputs are 8bits png frames named
+* OUT_PREFIX0000.png, OUT_PREFIX0001.png, ...
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <iostream>
+#include "io_png/io_png.h"
+#include "MIRE.h"
+#include "MIRE_stream.h"
+
+/**
+* @fn static double wall_time()
+* @brief Current time in seconds.
+*/
+static double wall_time()
+{
+    struct timeval t;
+    gettimeofday(&t,NULL);
+    return t.tv_sec+1e-6*t.tv_usec;
+}
+
+/**
+* @fn main(int argc, char **argv)
+* @brief main function
+* @param argc
+* @param **argv : OUT_PREFIX prefix of the output frames, then the input
+* frames, gray-level (1 channel) PNG images of the same size.
+*/
+int main(int argc, char **argv)
+{
+//Check arguments : OUT_PREFIX FRAME1 [FRAME2 ...]
+    if (argc < 3)
+    {
+        std::cerr << " **************************************** " << std::endl
+        << " **********  MIRE stream  ************************* " << std::endl
+        << " ************************************************** " << std::endl
+        << "Usage: " << argv[0] << " OUT_PREFIX Frame1.png [Frame2.png ...]"
+        << std::endl
+        << "Input" << std::endl
+        << "Frames: columns artifacts, gray (1 channel),  PNG, same size."
+        << std::endl
+        << "Output" << std::endl
+        << "OUT_PREFIXnnnn.png: denoised frames in PNG. " << std::endl
+        << " ************************************************** " << std::endl;
+        return 1;
+    }
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////// CONSTANT PARAMETER DEFINITION////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+    const int SIGMA_MIN=0; // minimal std-dev of the Gaussian-weighting function
+    const int SIGMA_MAX=8; //maximal std-dev of the Gaussian-weighting function
+    const float DELTA=0.5; //step between two consecutive std-dev
+    const int ROW_STEP=1; // lines subsampling of the TV during the search
+    const int Q=64; // quantiles per column
+    const float ALPHA=0.25; // weight of a new frame in the quantiles
+    const float DRIFT_TH=0.5; // relative increase of the residual triggering
+                              // a new estimation of sigma
+
+    mire_stream S;
+    size_t W=0, H=0; // size of the frames
+    char name[4096];
+
+    for (int f=2;f<argc;f++)
+    {
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////// READ FRAME///////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+        float * Image;  //frame
+        size_t w1, h1; // width an height of the frame
+        if (NULL == (Image = read_png_f32_gray(argv[f], &w1, &h1)))
+        {
+            std::cerr << "Unable to load  file " << argv[f] << std::endl;
+            return 1;
+        }
+        if (f==2)
+        {
+            W=w1;
+            H=h1;
+            MIRE_stream_init(&S,w1,h1,Q,ALPHA,DRIFT_TH,SIGMA_MIN,SIGMA_MAX,
+                             DELTA,ROW_STEP);
+        }
+        else if (w1!=W || h1!=H)
+        {
+            std::cerr << "Frame " << argv[f] << " has not the size of the "
+                      << "first frame" << std::endl;
+            return 1;
+        }
+
+////////////////////////////////////////////////////////////////////////////////
+//////////////////////////PROCESSING THE FRAME//////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+// latency of the frame: wall time, the CPU time of clock() adding up the
+// threads with OpenMP
+        double start=wall_time();
+        bool estimated=MIRE_stream_frame(&S,Image);
+        double t=1000.0*(wall_time()-start);
+        printf("FRAME %d: SIGMA %f%s, %.2f ms\n",f-2,S.sigma_best,
+               estimated ? " (estimated)" : "",t);
+
+////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////IMPOSING [0,255]/////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+// the frames are clamped, not normalized, to keep the same dynamic
+        for (size_t i=0;i<w1*h1;i++)
+        {
+            if (Image[i]<0) Image[i]=0;
+            if (Image[i]>255) Image[i]=255;
+        }
+
+        snprintf(name,sizeof(name),"%s%04d.png",argv[1],f-2);
+        write_png_f32(name,Image,w1,h1,1);
+        free(Image);
+    }
+    printf("FRAMES: %d, ESTIMATIONS OF SIGMA: %d\n",S.n_frames,
+           S.n_estimations);
+
+    return 0;
+}
@@ -0,0 +1,263 @@
+/*
+* Copyright 2012 IPOL Image Processing On Line http://www.ipol.im/
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+* @file profile_MIRE.cpp
+* @brief Profiling of the stages of MIRE on synthetic striped images
+*
+* A synthetic image of the given size is made of a smooth scene, noise and
+* a random offset per column (the stripes) of the given amplitude (see
+* striped_image). The run time of each stage of MIRE is measured
+* separately: column_sorting, target_histogram, specify_column (all the
+* columns) and TV_column_norm, for one sigma, then the two steps of
+* MIRE_automatic: the choice of sigma (MIRE_automatic_sigma, on the sorted
+* columns) and the processing with the chosen sigma (MIRE_sorted), and
+* finally MIRE_automatic end to end (sorting included). The measures are
+* repeated for each number of threads of the list (with OpenMP), and
+* printed as a table and, optionally, as a JSON file.
+*/
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include "MIRE.h"
+#include "synthetic.h"
+
+/**
+* @fn static double wall_time()
+* @brief Current time in seconds.
+*/
+static double wall_time()
+{
+    struct timeval t;
+    gettimeofday(&t,NULL);
+    return t.tv_sec+1e-6*t.tv_usec;
+}
+
+/**
+* @brief Measures of one run: time of each stage in milliseconds.
+*/
+struct profile
+{
+    int threads;
+    double sorting, target, specify, TV, choice, apply, automatic;
+};
+
+/**
+* @fn main(int argc, char **argv)
+* @brief main function
+* @param argc
+* @param **argv : options -w WIDTH, -h HEIGHT, -a AMPLITUDE of the stripes,
+* -s SIGMA of the stages, -r REPEAT number of measures averaged, -t THREADS
+* list of numbers of threads (comma-separated), -j FILE JSON output.
+*/
+int main(int argc, char **argv)
+{
+    int w1=512, h1=512, REPEAT=5;
+    float amplitude=20, sigma=2;
+    std::string thread_list="1", json;
+
+    for (int i=1;i<argc;i++)
+    {
+        std::string option(argv[i]);
+        if (i+1>=argc || option.size()!=2 || option[0]!='-')
+        {
+            fprintf(stderr,"Usage: %s [-w WIDTH] [-h HEIGHT] [-a AMPLITUDE] "
+                    "[-s SIGMA] [-r REPEAT] [-t THREADS,...] [-j FILE]\n",
+                    argv[0]);
+            return 1;
+        }
+        const char *value=argv[++i];
+        switch (option[1])
+        {
+        case 'w': w1=atoi(value); break;
+        case 'h': h1=atoi(value); break;
+        case 'a': amplitude=atof(value); break;
+        case 's': sigma=atof(value); break;
+        case 'r': REPEAT=atoi(value); break;
+        case 't': thread_list=value; break;
+        case 'j': json=value; break;
+        default:
+            fprintf(stderr,"Unknown option %s\n",option.c_str());
+            return 1;
+        }
+    }
+    if (w1<2 || h1<1 || REPEAT<1 || sigma<=0)
+    {
+        fprintf(stderr,"Invalid parameters\n");
+        return 1;
+    }
+
+    std::vector <int> threads;
+    for (const char *p=thread_list.c_str();*p;)
+    {
+        char *end;
+        long n=strtol(p,&end,10);
+        if (end==p || (*end && *end!=',') || n<1)
+        {
+            fprintf(stderr,"Invalid number of threads in %s\n",
+                    thread_list.c_str());
+            return 1;
+        }
+        threads.push_back((int) n);
+        p=*end ? end+1 : end;
+    }
+    if (threads.empty())
+    {
+        fprintf(stderr,"Invalid number of threads in %s\n",thread_list.c_str());
+        return 1;
+    }
+
+    srand(1);
+    float *IMAGE=new float[w1*h1];
+    float *Imtemp=new float[w1*h1];
+    striped_image(IMAGE,w1,h1,amplitude);
+
+    std::vector <float> c_sorted, v;
+    std::vector <profile> runs;
+    float TV=0, sigma_best=0;
+
+// MIRE_automatic prints the chosen sigma at each call: the standard output
+// is sent to /dev/null during the measures
+    fflush(stdout);
+    int saved_stdout=dup(1);
+    int null_output=open("/dev/null",O_WRONLY);
+    if (null_output>=0)
+    {
+        dup2(null_output,1);
+        close(null_output);
+    }
+    for (int k=0;k<(int) threads.size();k++)
+    {
+        profile P;
+        P.threads=threads[k];
+#ifdef _OPENMP
+        omp_set_num_threads(P.threads);
+#else
+        if (P.threads!=1)
+            fprintf(stderr,"Compiled without OpenMP: %d threads measured "
+                    "as 1\n",P.threads);
+#endif
+        P.sorting=P.target=P.specify=P.TV=P.choice=P.apply=P.automatic=0;
+        for (int r=0;r<REPEAT;r++)
+        {
+            for (int i=0;i<w1*h1;i++)
+                Imtemp[i]=IMAGE[i];
+
+            double t0=wall_time();
+            column_sorting(Imtemp,w1,h1,c_sorted);
+            double t1=wall_time();
+            target_histogram(c_sorted,w1,h1,sigma,v);
+            double t2=wall_time();
+            for (int column=0;column<w1;column++)
+                specify_column(Imtemp,w1,h1,column,&v[column*h1]);
+            double t3=wall_time();
+            TV=TV_column_norm(Imtemp,w1,h1);
+            double t4=wall_time();
+
+            for (int i=0;i<w1*h1;i++)
+                Imtemp[i]=IMAGE[i];
+            column_sorting(Imtemp,w1,h1,c_sorted);
+            double t5=wall_time();
+            sigma_best=MIRE_automatic_sigma(Imtemp,c_sorted,w1,h1,0,8,0.5);
+            double t6=wall_time();
+            if (sigma_best!=0)
+                MIRE_sorted(Imtemp,c_sorted,sigma_best,w1,h1,v);
+            double t7=wall_time();
+
+            for (int i=0;i<w1*h1;i++)
+                Imtemp[i]=IMAGE[i];
+            double t8=wall_time();
+            MIRE_automatic(Imtemp,w1,h1,0,8,0.5);
+            double t9=wall_time();
+
+            P.sorting+=t1-t0;
+            P.target+=t2-t1;
+            P.specify+=t3-t2;
+            P.TV+=t4-t3;
+            P.choice+=t6-t5;
+            P.apply+=t7-t6;
+            P.automatic+=t9-t8;
+        }
+        P.sorting*=1000.0/REPEAT;
+        P.target*=1000.0/REPEAT;
+        P.specify*=1000.0/REPEAT;
+        P.TV*=1000.0/REPEAT;
+        P.choice*=1000.0/REPEAT;
+        P.apply*=1000.0/REPEAT;
+        P.automatic*=1000.0/REPEAT;
+        runs.push_back(P);
+    }
+    fflush(stdout);
+    if (saved_stdout>=0)
+    {
+        dup2(saved_stdout,1);
+        close(saved_stdout);
+    }
+
+    printf("\nimage %dx%d, stripes amplitude %g, sigma %g, TV %g, "
+           "sigma chosen %g, mean of %d runs (ms)\n",w1,h1,amplitude,sigma,TV,
+           sigma_best,REPEAT);
+    printf("%7s %14s %16s %14s %14s %20s %11s %14s\n","threads",
+           "column_sorting","target_histogram","specify_column",
+           "TV_column_norm","MIRE_automatic_sigma","MIRE_sorted",
+           "MIRE_automatic");
+    for (int k=0;k<(int) runs.size();k++)
+        printf("%7d %14.2f %16.2f %14.2f %14.2f %20.2f %11.2f %14.2f\n",
+               runs[k].threads,runs[k].sorting,runs[k].target,
+               runs[k].specify,runs[k].TV,runs[k].choice,runs[k].apply,
+               runs[k].automatic);
+
+    if (!json.empty())
+    {
+        FILE *f=fopen(json.c_str(),"w");
+        if (f==NULL)
+        {
+            fprintf(stderr,"Unable to write %s\n",json.c_str());
+            return 1;
+        }
+        fprintf(f,"{\n  \"width\": %d,\n  \"height\": %d,\n"
+                "  \"amplitude\": %g,\n  \"sigma\": %g,\n"
+                "  \"sigma_chosen\": %g,\n  \"repeat\": %d,\n"
+                "  \"runs\": [\n",w1,h1,amplitude,sigma,sigma_best,REPEAT);
+        for (int k=0;k<(int) runs.size();k++)
+            fprintf(f,"    {\"threads\": %d, \"column_sorting_ms\": %.3f, "
+                    "\"target_histogram_ms\": %.3f, "
+                    "\"specify_column_ms\": %.3f, "
+                    "\"TV_column_norm_ms\": %.3f, "
+                    "\"MIRE_automatic_sigma_ms\": %.3f, "
+                    "\"MIRE_sorted_ms\": %.3f, "
+                    "\"MIRE_automatic_ms\": %.3f}%s\n",runs[k].threads,
+                    runs[k].sorting,runs[k].target,runs[k].specify,runs[k].TV,
+                    runs[k].choice,runs[k].apply,runs[k].automatic,
+                    k+1<(int) runs.size() ? "," : "");
+        fprintf(f,"  ]\n}\n");
+        fclose(f);
+    }
+
+    delete [] IMAGE;
+    delete [] Imtemp;
+    return 0;
+}
@@ -0,0 +1,55 @@
+/*
+* Copyright 2012 IPOL Image Processing On Line http://www.ipol.im/
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+* @file synthetic.cpp
+* @brief Synthetic striped images for the benchmark and the profiler of MIRE
+*/
+
+#include <stdlib.h>
+#include <math.h>
+#include "synthetic.h"
+
+/**
+* @fn void striped_image(float *IMAGE, int w1, int h1, float amplitude)
+* @brief Synthetic striped image: smooth scene in [0,200] with a grid of
+* disks (radius 10, one every 64 pixels, 40 brighter), uniform noise in
+* [0,8) and an offset per column, uniform in [-amplitude,amplitude]. The
+* disks make the column histograms differ, so the sigma minimizing the TV
+* grows with the amplitude instead of always being the largest one (about
+* 3.5 for an amplitude of 20 on 512x512). The values are rounded down to
+* integers, as in an 8-bit image, which gives many ties. The random numbers
+* are drawn with rand(): seed with srand for reproducible images.
+* @param IMAGE output, w1*h1 values
+* @param w1 image width
+* @param h1 image height
+* @param amplitude amplitude of the stripes
+*/
+void striped_image(float *IMAGE, int w1, int h1, float amplitude)
+{
+    for (int column=0;column<w1;column++)
+    {
+        float offset=amplitude*(2.0f*rand()/RAND_MAX-1);
+        for (int line=0;line<h1;line++)
+        {
+            float scene=100+50*sin(6.2832f*column/w1)+50*cos(6.2832f*line/h1);
+            float x=column%64-32, y=line%64-32;
+            if (x*x+y*y<100) scene=scene+40;
+            IMAGE[line*w1+column]=floor(scene+offset+8.0f*rand()/RAND_MAX);
+        }
+    }
+}